@@ -0,0 +1,175 @@
+#pragma once
+#include "sense_channel.hpp"
+#include "types.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <thread>
+
+// The motor driver, writing the commands to the robot's motor bus
+class MotorDriver {
+public:
+  virtual ~MotorDriver() = default;
+  virtual void send(const ActuateCmd &cmd) = 0;
+};
+
+// Limits of the commands sent to the motors. Infinite limits leave the commands unchanged.
+struct ActuationLimits {
+  double max_accel{std::numeric_limits<double>::infinity()}; // velocity change per second
+  double max_jerk{std::numeric_limits<double>::infinity()};  // acceleration change per second
+  // Commands within the deadband of the last command sent are coalesced, not sent again
+  double deadband{0.0};
+  // An unchanged command is sent again once this long passed, e.g. for a motor watchdog. Zero never
+  // sends an unchanged command again.
+  std::chrono::nanoseconds keepalive{0};
+};
+
+// The stage between the executor and the motor driver. The commands of the ticks are shaped to the
+// rate and jerk limits, so the step between two elements handing off, e.g. walking at full velocity
+// and stopping, becomes a ramp. A shaped command equal to the last one sent is coalesced instead of
+// occupying the bus again.
+//
+// The commands are sent by the pipeline's own thread. Only the latest command is pending: when the
+// driver is still writing, a new command replaces the pending one, which is counted as superseded.
+// The tick thread never waits for the bus, actuate() only publishes the command and wakes the sender.
+//
+// The pipeline is the Actuator of a ChannelIo.
+class ActuationPipeline {
+public:
+  using time_point = std::chrono::steady_clock::time_point;
+
+  explicit ActuationPipeline(MotorDriver &driver, ActuationLimits limits = {})
+      : m_driver(driver), m_limits(limits) {
+    m_sender = std::thread([this] { send(); });
+  }
+
+  ActuationPipeline(const ActuationPipeline &) = delete;
+  ActuationPipeline &operator=(const ActuationPipeline &) = delete;
+
+  // Stops the sender after the pending command is sent
+  ~ActuationPipeline() {
+    m_running.store(false, std::memory_order_release);
+    m_pending.store(true, std::memory_order_seq_cst);
+    m_pending.notify_one();
+    m_sender.join();
+  }
+
+  // Shapes the command of the tick at now and hands it to the sender, unless it is coalesced
+  void actuate(const ActuateCmd &cmd, time_point now) {
+    ActuateCmd shaped{shape(cmd.velocity, now)};
+    if (m_published > 0 && std::abs(shaped.velocity - m_last.velocity) <= m_limits.deadband &&
+        (m_limits.keepalive.count() == 0 || now - m_last_ts < m_limits.keepalive)) {
+      m_coalesced.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    m_last = shaped;
+    m_last_ts = now;
+
+    auto &slot = m_mailbox.back();
+    slot.cmd = shaped;
+    slot.seq = ++m_published;
+    m_mailbox.publish();
+    m_pending.store(true, std::memory_order_seq_cst);
+    m_pending.notify_one();
+  }
+
+  // The last shaped command
+  ActuateCmd command() const { return ActuateCmd{m_velocity}; }
+
+  // The number of commands written to the driver
+  uint64_t sent() const { return m_sent.load(std::memory_order_relaxed); }
+  // The number of commands not sent because they matched the last one
+  uint64_t coalesced() const { return m_coalesced.load(std::memory_order_relaxed); }
+  // The number of commands replaced by a newer one before the driver got to them
+  uint64_t superseded() const { return m_superseded.load(std::memory_order_relaxed); }
+
+private:
+  struct Pending {
+    ActuateCmd cmd{};
+    uint64_t seq{0};
+  };
+
+  // Moves the velocity towards the target as far as the limits allow within the time since the last
+  // command. The acceleration is also bounded by the distance to the target, so it ramps down to
+  // zero as the velocity arrives at the target instead of overshooting it.
+  double shape(double target, time_point now) {
+    std::chrono::duration<double> elapsed = now - m_shape_ts;
+    double dt = m_shaped ? elapsed.count() : 0.0;
+    m_shape_ts = now;
+    m_shaped = true;
+
+    if (std::isinf(m_limits.max_accel) && std::isinf(m_limits.max_jerk)) {
+      m_velocity = target;
+      return m_velocity;
+    }
+    if (dt <= 0.0) {
+      return m_velocity;
+    }
+
+    double dv = target - m_velocity;
+    double a = std::clamp(dv / dt, -m_limits.max_accel, m_limits.max_accel);
+    if (!std::isinf(m_limits.max_jerk)) {
+      double jerk = m_limits.max_jerk * dt;
+      a = std::clamp(a, m_accel - jerk, m_accel + jerk);
+      double brake = std::sqrt(2.0 * m_limits.max_jerk * std::abs(dv));
+      a = std::clamp(a, -brake, brake);
+    }
+
+    double next = m_velocity + a * dt;
+    if ((dv > 0.0 && next > target) || (dv < 0.0 && next < target)) {
+      next = target;
+      a = dv / dt;
+    }
+    m_velocity = next;
+    m_accel = a;
+    return m_velocity;
+  }
+
+  void send() {
+    uint64_t sent_seq = 0;
+    for (;;) {
+      // read the flag before taking the command, so the command published prior to shutdown is sent
+      bool running = m_running.load(std::memory_order_acquire);
+
+      if (m_pending.exchange(false, std::memory_order_seq_cst)) {
+        const auto &p = m_mailbox.latest();
+        if (p.seq != sent_seq) {
+          m_superseded.fetch_add(p.seq - sent_seq - 1, std::memory_order_relaxed);
+          sent_seq = p.seq;
+          m_driver.send(p.cmd);
+          m_sent.fetch_add(1, std::memory_order_relaxed);
+        }
+        continue;
+      }
+      if (!running) {
+        break;
+      }
+
+      // sleeps until the flag is set again, by the next command or the destructor
+      m_pending.wait(false, std::memory_order_seq_cst);
+    }
+  }
+
+  MotorDriver &m_driver;
+  ActuationLimits m_limits;
+
+  // shaping and coalescing, owned by the tick thread
+  double m_velocity{0.0};
+  double m_accel{0.0};
+  time_point m_shape_ts{};
+  bool m_shaped{false}; // a command was shaped before, at m_shape_ts
+  ActuateCmd m_last{};
+  time_point m_last_ts{};
+  uint64_t m_published{0};
+
+  TripleBuffer<Pending> m_mailbox;
+  std::atomic<bool> m_pending{false};
+  std::atomic<bool> m_running{true};
+  std::atomic<uint64_t> m_sent{0};
+  std::atomic<uint64_t> m_coalesced{0};
+  std::atomic<uint64_t> m_superseded{0};
+  std::thread m_sender;
+};
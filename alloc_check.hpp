@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Opt-in detection of heap allocations on the tick thread. Build with BEHAVIOR_NO_ALLOC_CHECK=1
+// (cmake -DDFS_NO_ALLOC_CHECK=ON) and expand BEHAVIOR_ALLOC_HOOKS() once at namespace scope in the
+// executable, which replaces the global operator new. Every allocation made while a NoAllocScope is
+// active on the allocating thread is counted as a violation; the executors arm a scope around each
+// tick, starting the element is not checked. Set a breakpoint on alloc_check::on_violation to find
+// the culprit. Without the macro the scope is an empty object and the hooks expand to nothing.
+#ifndef BEHAVIOR_NO_ALLOC_CHECK
+#define BEHAVIOR_NO_ALLOC_CHECK 0
+#endif
+
+namespace alloc_check {
+inline thread_local bool t_armed = false;
+inline std::atomic<uint64_t> g_violations{0};
+
+// Called for every allocation on an armed thread. Must not allocate.
+[[gnu::noinline]] inline void on_violation(std::size_t) {
+  g_violations.fetch_add(1, std::memory_order_relaxed);
+}
+
+// The number of allocations made on armed threads since the start of the program
+inline uint64_t violations() { return g_violations.load(std::memory_order_relaxed); }
+
+inline void *allocate(std::size_t size, std::size_t align) {
+  if (t_armed) {
+    on_violation(size);
+  }
+  if (size == 0) {
+    size = 1;
+  }
+  void *p = align > alignof(std::max_align_t)
+                ? std::aligned_alloc(align, (size + align - 1) / align * align)
+                : std::malloc(size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+} // namespace alloc_check
+
+#if BEHAVIOR_NO_ALLOC_CHECK
+// Flags the heap allocations of the current thread for the lifetime of the scope
+class NoAllocScope {
+public:
+  NoAllocScope() : m_prev(alloc_check::t_armed) { alloc_check::t_armed = true; }
+  ~NoAllocScope() { alloc_check::t_armed = m_prev; }
+
+  NoAllocScope(const NoAllocScope &) = delete;
+  NoAllocScope &operator=(const NoAllocScope &) = delete;
+
+private:
+  bool m_prev;
+};
+
+// The replacement of the global allocation functions, including the sized deallocations the
+// compiler calls for sized types. The array and nothrow forms forward to them.
+#define BEHAVIOR_ALLOC_HOOKS()                                                                     \
+  void *operator new(std::size_t size) {                                                          \
+    return alloc_check::allocate(size, alignof(std::max_align_t));                                \
+  }                                                                                                \
+  void *operator new(std::size_t size, std::align_val_t align) {                                  \
+    return alloc_check::allocate(size, static_cast<std::size_t>(align));                          \
+  }                                                                                                \
+  void operator delete(void *p) noexcept { std::free(p); }                                        \
+  void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }                      \
+  void operator delete(void *p, std::size_t) noexcept { std::free(p); }                           \
+  void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }         \
+  static_assert(true, "")
+#else
+class NoAllocScope {
+public:
+  NoAllocScope() {} // user-provided, an unused scope does not warn
+};
+
+#define BEHAVIOR_ALLOC_HOOKS() static_assert(true, "")
+#endif
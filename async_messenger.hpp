@@ -0,0 +1,122 @@
+#pragma once
+#include "spsc_ring.hpp"
+#include "types.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <thread>
+
+// A MessengerBackend that keeps console I/O off of the tick thread. notify() copies the message
+// into a fixed-size binary record and pushes it into a lock-free SPSC ring; a background consumer
+// thread formats the records and writes them to the output stream. Structured log statements are
+// carried as their raw LogRecord and formatted by the consumer as well. When the ring is full the
+// record is dropped and counted instead of blocking the producer.
+//
+// The ring has a single producer, the thread ticking the behavior. Messages longer than the record
+// are truncated.
+class AsyncMessenger : public MessengerBackend {
+public:
+  static constexpr std::size_t RING_CAPACITY = 1024;
+  static constexpr std::size_t MAX_MSG_LEN = 96;
+
+  // A text message or a deferred log statement, formatted by the consumer
+  struct Record {
+    std::chrono::steady_clock::time_point ts;
+    const char *source;
+    bool is_log;
+    uint32_t len;
+    union {
+      char msg[MAX_MSG_LEN];
+      LogRecord log;
+    };
+  };
+
+  explicit AsyncMessenger(std::ostream &out = console_stream()) : m_out(out) {
+    m_consumer = std::thread([this] { consume(); });
+  }
+
+  AsyncMessenger(const AsyncMessenger &) = delete;
+  AsyncMessenger &operator=(const AsyncMessenger &) = delete;
+
+  // Stops the consumer after the remaining records are written
+  ~AsyncMessenger() {
+    m_running.store(false, std::memory_order_release);
+    m_consumer.join();
+  }
+
+  void post(const char *source, const char *msg, std::size_t len) override {
+    Record r;
+    r.ts = std::chrono::steady_clock::now();
+    r.source = source;
+    r.is_log = false;
+    r.len = static_cast<uint32_t>(std::min(len, MAX_MSG_LEN));
+    std::memcpy(r.msg, msg, r.len);
+    push(r);
+  }
+
+  void post(const char *source, const LogRecord &record) override {
+    Record r;
+    r.ts = std::chrono::steady_clock::now();
+    r.source = source;
+    r.is_log = true;
+    r.len = 0;
+    r.log = record;
+    push(r);
+  }
+
+  // The number of records dropped since construction because the ring was full
+  uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+  // The number of records written to the output stream
+  uint64_t written() const { return m_written.load(std::memory_order_relaxed); }
+
+private:
+  void push(const Record &r) {
+    if (!m_ring.try_push(r)) {
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  void consume() {
+    Record r;
+    uint64_t reported_drops = 0;
+    for (;;) {
+      // read the flag before draining, so the records posted prior to shutdown are written
+      bool running = m_running.load(std::memory_order_acquire);
+
+      bool any = false;
+      while (m_ring.try_pop(r)) {
+        m_out << "[" << r.source << "] ";
+        if (r.is_log) {
+          write_log(m_out, r.log) << '\n';
+        } else {
+          m_out.write(r.msg, r.len) << '\n';
+        }
+        m_written.fetch_add(1, std::memory_order_relaxed);
+        any = true;
+      }
+
+      auto drops = dropped();
+      if (drops != reported_drops) {
+        m_out << "[AsyncMessenger] dropped " << drops - reported_drops << " messages\n";
+        reported_drops = drops;
+        any = true;
+      }
+
+      if (any) {
+        m_out.flush();
+      } else if (!running) {
+        break;
+      } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+      }
+    }
+  }
+
+  std::ostream &m_out;
+  SpscRing<Record, RING_CAPACITY> m_ring;
+  std::atomic<uint64_t> m_dropped{0};
+  std::atomic<uint64_t> m_written{0};
+  std::atomic<bool> m_running{true};
+  std::thread m_consumer;
+};
@@ -0,0 +1,113 @@
+#pragma once
+#include "executor.hpp"
+#include "thread_pool.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Executes many independent behavior trees, e.g. one per simulated robot, in a single periodic loop.
+// Every period the robots are partitioned into contiguous ranges across a fixed ThreadPool and each
+// worker ticks its range; the loop then waits for the next deadline. The per-robot sense, services,
+// outcome and state are held in contiguous arrays indexed by robot, so a worker streams through
+// its range rather than chasing a thread per tree.
+//
+// A robot's tree is only ever ticked by one worker at a time, but different robots tick in parallel:
+// the robots' Services must be safe to use from several threads, e.g. a silenced messenger or a
+// thread-safe backend. The single-producer AsyncMessenger cannot be shared between robots.
+template <class Clock = SteadyClock> class BatchExecutor {
+public:
+  enum class State : uint8_t { Idle, Running, Done };
+
+  explicit BatchExecutor(std::size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+      : m_pool(threads) {}
+
+  // Adds a robot running the tree from the initial sense, returns the robot's index. The robots are
+  // added before run(), the running trees refer to their services held here.
+  std::size_t add(std::unique_ptr<BehaviorElement> tree, Services svc = {},
+                  const SenseInfo &initial = {}) {
+    m_trees.push_back(std::move(tree));
+    m_svcs.push_back(svc);
+    m_sense.push_back(initial);
+    m_out.emplace_back();
+    m_meta.emplace_back();
+    m_state.push_back(State::Idle);
+    return m_trees.size() - 1;
+  }
+
+  std::size_t size() const { return m_trees.size(); }
+
+  // Ticks every robot each period until all trees completed. Returns the number of ticks.
+  uint64_t run(const TickSchedule &schedule, Clock &clock) {
+    PeriodicScheduler<Clock> scheduler(schedule, clock);
+    auto start = clock.now();
+
+    m_pool.parallel_for(size(), [&](std::size_t begin, std::size_t end) {
+      for (auto i = begin; i < end; ++i) {
+        m_sense[i].ts = start;
+        m_svcs[i].lifecycle.now = start;
+        m_meta[i] = m_trees[i]->initialize(m_svcs[i]);
+        m_svcs[i].lifecycle.emit(LifecycleKind_INITIALIZE, m_trees[i].get(), m_meta[i].name);
+        m_state[i] = State::Running;
+      }
+    });
+
+    uint64_t ticks = 0;
+    std::size_t running = size();
+    auto now = start;
+    while (running > 0) {
+      std::atomic<std::size_t> completed{0};
+      m_pool.parallel_for(size(), [&](std::size_t begin, std::size_t end) {
+        std::size_t done = 0;
+        for (auto i = begin; i < end; ++i) {
+          if (m_state[i] != State::Running) {
+            continue;
+          }
+          // the previous command was applied until now
+          if (ticks > 0) {
+            Executor::simulate_walk(m_sense[i], m_out[i].actuate, now);
+          }
+          if (tick(i)) {
+            ++done;
+          }
+        }
+        completed.fetch_add(done, std::memory_order_relaxed);
+      });
+      running -= completed.load(std::memory_order_relaxed);
+      ++ticks;
+
+      if (running > 0) {
+        now = scheduler.wait_next();
+      }
+    }
+    return ticks;
+  }
+
+  State state(std::size_t robot) const { return m_state[robot]; }
+  const Outcome &outcome(std::size_t robot) const { return m_out[robot]; }
+  const SenseInfo &sense(std::size_t robot) const { return m_sense[robot]; }
+
+private:
+  // Ticks the robot, returns true when its tree completed
+  bool tick(std::size_t i) {
+    m_svcs[i].lifecycle.now = m_sense[i].ts;
+    m_svcs[i].lifecycle.emit(LifecycleKind_TICK, m_trees[i].get(), m_meta[i].name);
+    m_out[i] = m_trees[i]->tick(m_sense[i]);
+    if (m_out[i].value == Outcome::Return::Running) {
+      return false;
+    }
+    m_trees[i]->finalize();
+    m_svcs[i].lifecycle.emit(LifecycleKind_FINALIZE, m_trees[i].get(), m_meta[i].name,
+                             m_out[i].value);
+    m_state[i] = State::Done;
+    return true;
+  }
+
+  ThreadPool m_pool;
+  std::vector<std::unique_ptr<BehaviorElement>> m_trees;
+  std::vector<Services> m_svcs;
+  std::vector<SenseInfo> m_sense;
+  std::vector<Outcome> m_out;
+  std::vector<ElementMeta> m_meta;
+  std::vector<State> m_state;
+};
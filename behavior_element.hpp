@@ -0,0 +1,71 @@
+#pragma once
+#include "types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// The interface every element implements, without the MotionElement and composite templates of
+// element.hpp. Headers that only hold or tick elements include this one.
+
+class BehaviorElement;
+
+// The composites a tree can be compiled from, see FlatTree. Any other element is a leaf.
+enum ElementKind : uint8_t {
+  ElementKind_LEAF = 0,
+  ElementKind_SEQUENCE = 1,
+  ElementKind_FALLBACK = 2,
+  ElementKind_INVERTER = 3,
+};
+
+// The structure of a composite: its kind and its children in order
+struct ElementStructure {
+  ElementKind kind{ElementKind_LEAF};
+  std::size_t size{0};
+  const std::reference_wrapper<BehaviorElement> *children{nullptr};
+};
+
+// The memory a tree occupies, see BehaviorElement::footprint()
+struct Footprint {
+  std::size_t bytes{0};    // the elements and their out-of-line storage, e.g. long child lists
+  std::size_t elements{0}; // the elements counted
+  std::size_t unknown{0};  // the elements not reporting their size, their bytes are not counted
+
+  Footprint operator+(const Footprint &o) const {
+    return Footprint{bytes + o.bytes, elements + o.elements, unknown + o.unknown};
+  }
+};
+
+// C++ interface or abstract base class describing an element of behavior. The element has initialize
+// and finalize methods acting as constructors/destructors allowing the object to be reused more than
+// once, as in a loop. The tick method is invoked periodically and the element should perform its
+// work there.
+class BehaviorElement {
+public:
+  // Trees own their elements through the interface, e.g. a BatchExecutor or a MissionPlanner
+  virtual ~BehaviorElement() = default;
+
+  // The services are kept by reference until finalize(), see Services
+  virtual ElementMeta initialize(const Services &) = 0;
+  virtual Outcome tick(const SenseInfo &) = 0;
+  virtual void finalize() = 0;
+
+  // When the running element needs its next tick, see WakeCondition. By default on every sample.
+  virtual WakeCondition wake_condition() const { return WakeCondition{}; }
+
+  // The kind and children of a composite, for compiling the tree into another representation. By
+  // default the element is a leaf.
+  virtual ElementStructure structure() const { return ElementStructure{}; }
+
+  // The memory of the element and the subtree below it, for checking a tree against a RAM budget at
+  // startup. By default the element's size is unknown.
+  virtual Footprint footprint() const { return Footprint{0, 1, 1}; }
+};
+
+// The bytes the element types occupy in place, for checking a RAM budget at build time:
+//
+//   static_assert(TREE_BYTES<StaticSequence<WalkToPosition, Stop>> <= 256);
+//   static_assert(TREE_BYTES<WalkToPosition, Stop, SequenceElement> <= 256);
+//
+// A static composite holding its children by value contains its whole subtree. A dynamic composite
+// holds up to ChildList::INLINE children in place, a longer list adds a pointer per child.
+template <class... Ts> constexpr std::size_t TREE_BYTES = (sizeof(Ts) + ... + std::size_t{0});
@@ -0,0 +1,497 @@
+#include "async_messenger.hpp"
+#include "batch_executor.hpp"
+#include "blackboard.hpp"
+#include "coroutine_element.hpp"
+#include "element.hpp"
+#include "executor.hpp"
+#include "flat_tree.hpp"
+#include "mission_planner.hpp"
+#include "motion_elements.hpp"
+#include "sense_history.hpp"
+#include "state_machine.hpp"
+#include "static_elements.hpp"
+#include "tree_builder.hpp"
+#include "tree_file.hpp"
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Microbenchmarks for the cost of a tick. Every benchmark runs on simulated time: the sense
+// timestamp is advanced by the period on every iteration, nothing sleeps, so the numbers are the
+// cost of the behavior logic alone.
+
+namespace {
+
+constexpr std::chrono::milliseconds PERIOD{1};
+constexpr std::size_t ITERATIONS = 1000000;
+
+// A motion element that never completes, used as the leaf of the composite benchmarks so the trees
+// keep running for the whole measurement.
+struct Hold : public MotionElement<Hold> {
+  static constexpr char const *const NAME = "Hold";
+  static constexpr ReactionDef KNEE_JERK_REACTION = ReactionDef_ENABLED;
+  static constexpr ReactionDef FLINCH_REACTION = ReactionDef_DISABLED;
+
+  static Outcome motion_element_tick(Hold &, const SenseInfo &in) {
+    Outcome o;
+    o.value = Outcome::Return::Running;
+    o.actuate.velocity = in.measured_velocity * 0.5;
+    return o;
+  }
+};
+
+// WalkToPosition written as a coroutine, for comparing the cost of resuming a coroutine with the
+// hand-written state of the MotionElement
+struct CoroutineWalk : public CoroutineElement {
+  CoroutineWalk(double goal, std::pmr::memory_resource *frames)
+      : CoroutineElement("CoroutineWalk", reaction_bit(ReactionId_KNEE_JERK), frames),
+        goal_x(goal) {}
+
+  Task body() override {
+    auto init_ts = sense().ts;
+    for (;;) {
+      auto dist_x = goal_x - sense().measured_x;
+      actuate({dist_x >= 0 ? WalkToPosition::MY_VELO : -WalkToPosition::MY_VELO});
+      if (std::abs(dist_x) < WalkToPosition::GOAL_THRESHOLD) {
+        co_return Outcome::Return::Success;
+      }
+      if (sense().ts - init_ts > WalkToPosition::TIMEOUT) {
+        co_return Outcome::Return::Fail;
+      }
+      if (sense().is_knee_jerking) {
+        actuate({0});
+      }
+      co_await next_tick();
+    }
+  }
+
+  double goal_x;
+};
+
+// keeps the optimizer from discarding the ticks
+volatile double g_sink = 0;
+volatile int g_status_sink = 0;
+
+// Ticks the element for the given number of iterations and prints the mean cost of a tick. The
+// element is re-initialized whenever it completes, so elements that finish quickly are measured
+// across their whole lifecycle.
+template <class Element>
+void bench(const char *name, Element &element, Services svc, SenseInfo sense,
+           std::size_t iterations = ITERATIONS) {
+  element.initialize(svc);
+
+  double acc = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) {
+    sense.ts += PERIOD;
+    auto o = element.tick(sense);
+    acc += o.actuate.velocity;
+    g_status_sink = static_cast<int>(o.value);
+    if (o.value != Outcome::Return::Running) {
+      element.finalize();
+      element.initialize(svc);
+    }
+  }
+  auto stop = std::chrono::steady_clock::now();
+  element.finalize();
+  g_sink = acc;
+
+  std::chrono::duration<double, std::nano> elapsed = stop - start;
+  std::printf("%-40s %10zu %12.1f\n", name, iterations, elapsed.count() / iterations);
+}
+
+// Builds a chain of nested SequenceElements, depth levels deep, with a Hold leaf.
+struct DeepSequence {
+  explicit DeepSequence(std::size_t depth) {
+    levels.reserve(depth);
+    levels.push_back(std::make_unique<SequenceElement>(SequenceElement::Elements{std::ref(leaf)}));
+    for (std::size_t i = 1; i < depth; ++i) {
+      levels.push_back(std::make_unique<SequenceElement>(
+          SequenceElement::Elements{std::ref<BehaviorElement>(*levels.back())}));
+    }
+  }
+  SequenceElement &root() { return *levels.back(); }
+
+  Hold leaf;
+  std::vector<std::unique_ptr<SequenceElement>> levels;
+};
+
+// Hides the concrete type of the element from the optimizer, forcing virtual dispatch
+BehaviorElement &opaque(BehaviorElement &e) {
+  static BehaviorElement *volatile ptr;
+  ptr = &e;
+  return *ptr;
+}
+
+// Pushes a sample into the history and runs the filter kernels a typical tick would query
+void bench_history(const char *name, std::size_t window, std::size_t iterations = ITERATIONS) {
+  SenseHistory history;
+  SenseInfo sense;
+  sense.measured_velocity = 1.0;
+
+  double acc = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) {
+    sense.ts += PERIOD;
+    sense.measured_x += 0.001;
+    history.push(sense);
+    acc += history.average_velocity(window) + history.velocity_from_x(window);
+    g_status_sink = history.is_stalled(window, 0.01);
+  }
+  auto stop = std::chrono::steady_clock::now();
+  g_sink = acc;
+
+  std::chrono::duration<double, std::nano> elapsed = stop - start;
+  std::printf("%-40s %10zu %12.1f\n", name, iterations, elapsed.count() / iterations);
+}
+
+// Shares a goal between a writer and a reader ticking every PERIOD, with the writer moving the goal
+// every 100 ticks: through a blackboard entry, a std::function returning a captured shared_ptr, and
+// a shared_ptr republished under a mutex
+void bench_goal(std::size_t iterations = ITERATIONS) {
+  struct GoalKey {
+    using type = double;
+  };
+  Blackboard<GoalKey> board;
+  auto &entry = board.entry<GoalKey>();
+  uint64_t version = 0;
+  double goal = 0;
+  double acc = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) {
+    if (i % 100 == 0) {
+      entry.write(static_cast<double>(i));
+    }
+    if (entry.read_if_changed(version, goal)) {
+      acc += goal;
+    }
+  }
+  auto mid_board = std::chrono::steady_clock::now();
+
+  auto shared = std::make_shared<double>(0.0);
+  std::function<double()> read_goal = [shared] { return *shared; };
+  for (std::size_t i = 0; i < iterations; ++i) {
+    if (i % 100 == 0) {
+      *shared = static_cast<double>(i);
+    }
+    acc += read_goal();
+  }
+  auto mid_function = std::chrono::steady_clock::now();
+
+  std::mutex mutex;
+  auto published = std::make_shared<const double>(0.0);
+  for (std::size_t i = 0; i < iterations; ++i) {
+    if (i % 100 == 0) {
+      auto next = std::make_shared<const double>(static_cast<double>(i));
+      std::lock_guard<std::mutex> lock(mutex);
+      published = std::move(next);
+    }
+    std::shared_ptr<const double> current;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      current = published;
+    }
+    acc += *current;
+  }
+  auto stop = std::chrono::steady_clock::now();
+  g_sink = acc;
+
+  std::chrono::duration<double, std::nano> board_ns = mid_board - start;
+  std::chrono::duration<double, std::nano> function_ns = mid_function - mid_board;
+  std::chrono::duration<double, std::nano> shared_ns = stop - mid_function;
+  std::printf("%-40s %10zu %12.1f\n", "goal via Blackboard", iterations,
+              board_ns.count() / iterations);
+  std::printf("%-40s %10zu %12.1f\n", "goal via std::function+shared_ptr", iterations,
+              function_ns.count() / iterations);
+  std::printf("%-40s %10zu %12.1f\n", "goal via mutex+shared_ptr", iterations,
+              shared_ns.count() / iterations);
+}
+
+// Prints the bytes of the elements and of a walk/walk/stop tree
+void print_footprints() {
+  std::printf("%-40s %10s\n", "footprint", "bytes");
+  std::printf("%-40s %10zu\n", "Services", sizeof(Services));
+  std::printf("%-40s %10zu\n", "Stop", TREE_BYTES<Stop>);
+  std::printf("%-40s %10zu\n", "WalkToPosition", TREE_BYTES<WalkToPosition>);
+  std::printf("%-40s %10zu\n", "SequenceElement", TREE_BYTES<SequenceElement>);
+  std::printf("%-40s %10zu\n", "StaticSequence<WalkToPosition, Stop>",
+              TREE_BYTES<StaticSequence<WalkToPosition, Stop>>);
+
+  TreeBuilder tree;
+  auto &walk = tree.make<WalkToPosition>(1.0);
+  auto &back = tree.make<WalkToPosition>(0.0);
+  auto &stop = tree.make<Stop>();
+  auto footprint = tree.sequence({walk, back, stop}).footprint();
+  std::printf("%-40s %10zu (%zu elements)\n\n", "sequence(walk, walk, stop)", footprint.bytes,
+              footprint.elements);
+}
+
+// Builds and tears down a walk/walk/stop tree, on the heap or in a TreeBuilder arena
+void bench_build(std::size_t iterations = ITERATIONS / 10) {
+  double acc = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) {
+    auto walk = std::make_unique<WalkToPosition>(1.0);
+    auto back = std::make_unique<WalkToPosition>(0.0);
+    auto stop = std::make_unique<Stop>();
+    auto root = std::make_unique<SequenceElement>(
+        SequenceElement::Elements{std::ref(*walk), std::ref(*back), std::ref(*stop)});
+    acc += static_cast<double>(reinterpret_cast<uintptr_t>(root.get()) & 1);
+  }
+  auto mid = std::chrono::steady_clock::now();
+
+  alignas(64) static char buffer[4096];
+  TreeBuilder tree(buffer, sizeof(buffer));
+  for (std::size_t i = 0; i < iterations; ++i) {
+    auto &walk = tree.make<WalkToPosition>(1.0);
+    auto &back = tree.make<WalkToPosition>(0.0);
+    auto &stop = tree.make<Stop>();
+    auto &root = tree.sequence({walk, back, stop});
+    acc += static_cast<double>(reinterpret_cast<uintptr_t>(&root) & 1);
+    tree.release();
+  }
+  auto stop = std::chrono::steady_clock::now();
+  g_sink = acc;
+
+  std::chrono::duration<double, std::nano> heap = mid - start;
+  std::chrono::duration<double, std::nano> arena = stop - mid;
+  std::printf("%-40s %10zu %12.1f ns/tree\n", "build+teardown 4 nodes heap", iterations,
+              heap.count() / iterations);
+  std::printf("%-40s %10zu %12.1f ns/tree\n", "build+teardown 4 nodes TreeBuilder", iterations,
+              arena.count() / iterations);
+}
+
+// Loads the walk/walk/stop tree of bench_build from a tree file into a TreeBuilder arena, mapping
+// the file for every tree
+void bench_load(std::size_t iterations = ITERATIONS / 100) {
+  const char *path = "dfs_bench.tree";
+  write_tree_file(path, TreeSpec{"Sequence",
+                                 {},
+                                 {{"WalkToPosition", {1.0}, {}},
+                                  {"WalkToPosition", {0.0}, {}},
+                                  {"Stop", {}, {}}}});
+  auto registry = ElementRegistry::with_composites();
+  registry.add<WalkToPosition>();
+  registry.add<Stop>();
+
+  double acc = 0;
+  TreeBuilder tree;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) {
+    TreeFile file(path);
+    auto &root = load_tree(file, registry, tree);
+    acc += static_cast<double>(reinterpret_cast<uintptr_t>(&root) & 1);
+    tree.release();
+  }
+  auto stop = std::chrono::steady_clock::now();
+  g_sink = acc;
+  std::remove(path);
+
+  std::chrono::duration<double, std::nano> elapsed = stop - start;
+  std::printf("%-40s %10zu %12.1f ns/tree\n", "load tree file 4 nodes", iterations,
+              elapsed.count() / iterations);
+}
+
+// Runs whole missions with the executor on a SimClock and prints the mean wall time per mission
+void bench_mission(const char *name, BehaviorElement &element, const Services &svc,
+                   std::size_t missions = 1000) {
+  TickSchedule schedule;
+  schedule.period = PERIOD;
+
+  auto start = std::chrono::steady_clock::now();
+  SimClock::duration sim_time{};
+  for (std::size_t i = 0; i < missions; ++i) {
+    SimClock clock;
+    auto o = Executor::run(element, schedule, svc, clock);
+    g_status_sink = static_cast<int>(o.value);
+    sim_time += clock.now() - SimClock::time_point{};
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  std::chrono::duration<double, std::micro> elapsed = stop - start;
+  std::chrono::duration<double> sim_s = sim_time;
+  std::printf("%-40s %10zu %9.1f us/mission (%.1f s simulated)\n", name, missions,
+              elapsed.count() / missions, sim_s.count() / missions);
+}
+
+// Runs a fleet of walk-then-stop robots with the BatchExecutor on a SimClock
+void bench_fleet(const char *name, std::size_t robots, const Services &svc) {
+  using WalkThenStop = StaticSequence<WalkToPosition, Stop>;
+
+  BatchExecutor<SimClock> fleet;
+  for (std::size_t i = 0; i < robots; ++i) {
+    auto goal = 1.0 + static_cast<double>(i % 4);
+    fleet.add(std::make_unique<WalkThenStop>(WalkToPosition{goal}, Stop{}), svc);
+  }
+
+  TickSchedule schedule;
+  schedule.period = PERIOD;
+  SimClock clock;
+
+  auto start = std::chrono::steady_clock::now();
+  auto ticks = fleet.run(schedule, clock);
+  auto stop = std::chrono::steady_clock::now();
+
+  std::chrono::duration<double, std::nano> elapsed = stop - start;
+  std::printf("%-40s %10llu %12.1f ns/robot-tick (%zu threads)\n", name,
+              static_cast<unsigned long long>(ticks), elapsed.count() / (ticks * robots),
+              static_cast<std::size_t>(std::max(1u, std::thread::hardware_concurrency())));
+}
+
+// Plans a mission out of walk-then-stop candidates with the MissionPlanner, the best is the nearest
+// goal and the farther ones are cut off
+void bench_planner(const char *name, std::size_t candidates, bool early_cutoff) {
+  using WalkThenStop = StaticSequence<WalkToPosition, Stop>;
+
+  std::vector<MissionPlanner::Factory> factories;
+  for (std::size_t i = 0; i < candidates; ++i) {
+    auto goal = 1.0 + static_cast<double>((i * 7) % candidates) / 8.0;
+    factories.push_back(
+        [goal] { return std::make_unique<WalkThenStop>(WalkToPosition{goal}, Stop{}); });
+  }
+  PlannerOptions options;
+  options.schedule.period = PERIOD;
+  options.early_cutoff = early_cutoff;
+
+  MissionPlanner planner;
+  auto start = std::chrono::steady_clock::now();
+  auto results = planner.evaluate(factories, SenseInfo{}, options);
+  auto stop = std::chrono::steady_clock::now();
+
+  uint64_t ticks = 0;
+  std::size_t abandoned = 0;
+  for (const auto &r : results) {
+    ticks += r.ticks;
+    abandoned += r.abandoned ? 1 : 0;
+  }
+  g_status_sink = static_cast<int>(MissionPlanner::best(results));
+
+  std::chrono::duration<double, std::milli> elapsed = stop - start;
+  std::printf("%-40s %10llu %9.2f ms/plan (%zu of %zu abandoned)\n", name,
+              static_cast<unsigned long long>(ticks), elapsed.count(), abandoned, candidates);
+}
+
+} // namespace
+
+int main(int, char **) {
+  Services quiet;
+  quiet.messenger.threshold = LogLevel::Off;
+
+  // the messenger-on benchmarks go through the async backend into a discarding stream
+  std::ostream null_out(nullptr);
+  AsyncMessenger async(null_out);
+  Services loud;
+  loud.messenger.backend = &async;
+  LifecycleLog lifecycle_log(loud.messenger);
+  loud.lifecycle.subscribe(&lifecycle_log);
+
+  SenseInfo moving;
+  moving.measured_velocity = 1.0;
+  SenseInfo stopped;
+
+  print_footprints();
+
+  std::printf("%-40s %10s %12s\n", "benchmark", "ticks", "ns/tick");
+
+  // leaf elements
+  {
+    Stop stop;
+    bench("Stop (running)", stop, quiet, moving);
+    bench("Stop (completing every tick)", stop, quiet, stopped);
+
+    WalkToPosition walk(1e9); // never reaches the goal
+    bench("WalkToPosition messenger=off", walk, quiet, moving);
+    bench("WalkToPosition messenger=async", walk, loud, moving);
+
+    BlackboardEntry<double> goal;
+    goal.write(1e9);
+    WalkToPosition board_walk(goal);
+    bench("WalkToPosition blackboard goal", board_walk, quiet, moving);
+
+    std::pmr::unsynchronized_pool_resource frames;
+    CoroutineWalk coroutine_walk(1e9, &frames);
+    bench("CoroutineWalk (resume per tick)", coroutine_walk, quiet, moving);
+    CoroutineWalk short_walk(0.0, &frames); // completes on its first tick
+    bench("CoroutineWalk (frame per tick)", short_walk, quiet, moving);
+  }
+
+  // dispatch
+  {
+    Hold hold;
+    bench("Hold CRTP (direct)", hold, quiet, moving);
+    bench("Hold virtual (BehaviorElement&)", opaque(hold), quiet, moving);
+  }
+
+  // composites
+  {
+    Hold hold;
+    Stop stop;
+    SequenceElement shallow({std::ref(hold), std::ref(stop)});
+    bench("SequenceElement depth=1 messenger=off", shallow, quiet, moving);
+    bench("SequenceElement depth=1 messenger=async", shallow, loud, moving);
+
+    StaticSequence<Hold &, Stop &> shallow_static(hold, stop);
+    bench("StaticSequence depth=1 messenger=off", shallow_static, quiet, moving);
+
+    DeepSequence deep4(4);
+    bench("SequenceElement depth=4 messenger=off", deep4.root(), quiet, moving);
+
+    DeepSequence deep8(8);
+    bench("SequenceElement depth=8 messenger=off", deep8.root(), quiet, moving);
+
+    DeepSequence deep32(32);
+    bench("SequenceElement depth=32 messenger=off", deep32.root(), quiet, moving);
+
+    // a machine preempting its running state on a guard, evaluated every tick
+    StateMachineElement::Definition def;
+    auto holding = def.state(hold);
+    auto stopping = def.state(stop);
+    def.when(holding, [](const SenseInfo &s) { return s.is_flinching; }, stopping,
+             SenseField_FLINCHING);
+    StateMachineElement machine(def);
+    bench("StateMachineElement guard+state", machine, quiet, moving);
+
+    FlatTree flat4(deep4.root());
+    bench("FlatTree depth=4 messenger=off", flat4, quiet, moving);
+    FlatTree flat32(deep32.root());
+    bench("FlatTree depth=32 messenger=off", flat32, quiet, moving);
+
+    StaticSequence<StaticSequence<StaticSequence<StaticSequence<Hold>>>> deep_static(
+        StaticSequence<StaticSequence<StaticSequence<Hold>>>(
+            StaticSequence<StaticSequence<Hold>>(StaticSequence<Hold>(Hold{}))));
+    bench("StaticSequence depth=4 messenger=off", deep_static, quiet, moving);
+  }
+
+  // sense history filters
+  bench_history("SenseHistory push+avg+slope+stall n=32", 32);
+
+  // shared data
+  bench_goal();
+
+  // tree construction
+  bench_build();
+  bench_load();
+
+  // missions on simulated time
+  {
+    Stop stop;
+    WalkToPosition walk(4);
+    SequenceElement sequence({std::ref(walk), std::ref(stop)});
+    bench_mission("Executor<SimClock> walk(4)+stop @1kHz", sequence, quiet);
+  }
+
+  // fleets of robots on simulated time
+  bench_fleet("BatchExecutor<SimClock> 10k robots", 10000, quiet);
+
+  // mission planning on simulated time
+  bench_planner("MissionPlanner 256 candidates", 256, false);
+  bench_planner("MissionPlanner 256 candidates cutoff", 256, true);
+
+  if (async.dropped() > 0) {
+    std::printf("async messenger dropped %llu messages\n",
+                static_cast<unsigned long long>(async.dropped()));
+  }
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+
+// One versioned value of a Blackboard. The value is guarded by a sequence lock: a write makes the
+// sequence odd, stores the value and makes it even again, a read copies the value and retries when
+// the sequence was odd or moved meanwhile. Readers never block the writer, and a read on any thread
+// returns a value written as a whole. Writers may be on any thread too, they serialize on the
+// sequence, but the entry is meant for one writer at a time, e.g. a planner element.
+//
+// The version counts the writes, so a reader keeping the version it read last skips the copy, and
+// whatever it derives from the value, while nothing changed:
+//
+//   if (goal.read_if_changed(m_goal_version, m_goal)) {
+//     replan(m_goal);
+//   }
+//
+// The value is stored as relaxed atomic words, which keeps the racing copy of a retried read
+// well-defined; T must be trivially copyable.
+template <class T> class BlackboardEntry {
+public:
+  static_assert(std::is_trivially_copyable<T>::value, "blackboard values are copied as bytes");
+
+  BlackboardEntry() { store(T{}); }
+
+  void write(const T &value) {
+    auto seq = m_seq.load(std::memory_order_relaxed);
+    for (;;) {
+      if ((seq & 1) == 0 &&
+          m_seq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire,
+                                      std::memory_order_relaxed)) {
+        break;
+      }
+      seq = m_seq.load(std::memory_order_relaxed);
+    }
+    // the value stores may not become visible before the odd sequence
+    std::atomic_thread_fence(std::memory_order_release);
+    store(value);
+    m_seq.store(seq + 2, std::memory_order_release);
+  }
+
+  T read() const {
+    T value;
+    read(value);
+    return value;
+  }
+
+  // Copies the value, returns its version
+  uint64_t read(T &value) const {
+    for (;;) {
+      auto before = m_seq.load(std::memory_order_acquire);
+      if (before & 1) {
+        continue;
+      }
+      load(value);
+      // the value loads may not be reordered after the second sequence load
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (m_seq.load(std::memory_order_relaxed) == before) {
+        return before / 2;
+      }
+    }
+  }
+
+  // Copies the value when its version differs from version, and updates version. False, without
+  // copying, when nothing was written since.
+  bool read_if_changed(uint64_t &version, T &value) const {
+    if (this->version() == version) {
+      return false;
+    }
+    version = read(value);
+    return true;
+  }
+
+  // The number of writes so far. A write in progress is not counted until it completes.
+  uint64_t version() const { return m_seq.load(std::memory_order_acquire) / 2; }
+
+private:
+  static constexpr std::size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  void store(const T &value) {
+    uint64_t words[WORDS]{};
+    std::memcpy(words, &value, sizeof(T));
+    for (std::size_t i = 0; i < WORDS; ++i) {
+      m_words[i].store(words[i], std::memory_order_relaxed);
+    }
+  }
+
+  void load(T &value) const {
+    uint64_t words[WORDS];
+    for (std::size_t i = 0; i < WORDS; ++i) {
+      words[i] = m_words[i].load(std::memory_order_relaxed);
+    }
+    std::memcpy(&value, words, sizeof(T));
+  }
+
+  std::atomic<uint64_t> m_seq{0};
+  std::atomic<uint64_t> m_words[WORDS];
+};
+
+// Data shared between the elements of a tree, and with threads outside of it, under keys known at
+// compile time. A key is a type naming the value's type:
+//
+//   struct GoalKey {
+//     using type = double;
+//   };
+//   using MissionBoard = Blackboard<GoalKey, ObstacleKey>;
+//
+//   MissionBoard board;
+//   PlanGoal plan(board.entry<GoalKey>());      // writes the goal
+//   WalkToPosition walk(board.entry<GoalKey>()); // walks to the latest goal
+//
+// The entries are stored in place, in key order, so the board is one flat object without any
+// allocation, and looking an entry up is resolved at compile time. Elements take the entries they
+// use by reference when they are constructed, they do not depend on the rest of the board. Each
+// entry is on its own cache line, a writer does not disturb the readers of the other entries.
+template <class... Keys> class Blackboard {
+  template <class Key> struct alignas(64) Slot {
+    BlackboardEntry<typename Key::type> entry;
+  };
+
+  template <class Key, class First, class... Rest> static constexpr std::size_t index_of() {
+    if constexpr (std::is_same<Key, First>::value) {
+      return 0;
+    } else {
+      static_assert(sizeof...(Rest) > 0, "the key is not on the blackboard");
+      return 1 + index_of<Key, Rest...>();
+    }
+  }
+
+public:
+  template <class Key> BlackboardEntry<typename Key::type> &entry() {
+    return std::get<index_of<Key, Keys...>()>(m_slots).entry;
+  }
+  template <class Key> const BlackboardEntry<typename Key::type> &entry() const {
+    return std::get<index_of<Key, Keys...>()>(m_slots).entry;
+  }
+
+  template <class Key> void write(const typename Key::type &value) { entry<Key>().write(value); }
+  template <class Key> typename Key::type read() const { return entry<Key>().read(); }
+  template <class Key> uint64_t version() const { return entry<Key>().version(); }
+
+private:
+  std::tuple<Slot<Keys>...> m_slots;
+};
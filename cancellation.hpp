@@ -0,0 +1,60 @@
+#pragma once
+#include "behavior_element.hpp"
+#include <atomic>
+#include <cstdint>
+
+// Stops or replaces the tree of a running executor from outside of the tick thread, e.g. main, a
+// higher-priority behavior or the reflex layer reacting to an obstacle.
+//
+//   CancelToken token;
+//   auto result = std::async(std::launch::async,
+//                            [&] { return Executor::run(mission, schedule, svc, token); });
+//   ...
+//   token.preempt(evade); // the mission is finalized, evade takes over in the same tick
+//   token.cancel();       // evade is finalized, the run returns
+//
+// The executor takes the requests at the start of its next tick, so a request takes effect within
+// one period. Stopping a tree finalizes its running chain, every composite finalizes its running
+// child, and the MotionElements release their reactions; the replacement starts and is ticked in
+// the same tick, on the same thread. A cancelled run returns Running, the tree did not complete.
+//
+// Both requests are a single lock-free store, safe to make from any thread and from a signal
+// handler. A preemption made before the previous one was taken replaces it.
+class CancelToken {
+public:
+  void cancel() { m_cancelled.store(true, std::memory_order_release); }
+  bool cancelled() const { return m_cancelled.load(std::memory_order_acquire); }
+
+  // The next must stay alive until the run ends
+  void preempt(BehaviorElement &next) { m_next.store(&next, std::memory_order_release); }
+
+  // The pending preemption, taking it. Called by the executor.
+  BehaviorElement *take_preemption() {
+    if (m_next.load(std::memory_order_relaxed) == nullptr) {
+      return nullptr;
+    }
+    return m_next.exchange(nullptr, std::memory_order_acq_rel);
+  }
+
+  // Counts a preemption taken and completed: the replaced tree is finalized and no longer used by
+  // the run, its owner may destroy it. Called by the executor.
+  void preempted() { m_preemptions.fetch_add(1, std::memory_order_release); }
+
+  // The preemptions completed so far
+  uint64_t preemptions() const { return m_preemptions.load(std::memory_order_acquire); }
+
+  // Clears the requests, for reusing the token with another run
+  void reset() {
+    m_cancelled.store(false, std::memory_order_relaxed);
+    m_next.store(nullptr, std::memory_order_relaxed);
+  }
+
+private:
+  static_assert(std::atomic<bool>::is_always_lock_free &&
+                    std::atomic<BehaviorElement *>::is_always_lock_free,
+                "the requests must be signal safe");
+
+  std::atomic<bool> m_cancelled{false};
+  std::atomic<BehaviorElement *> m_next{nullptr};
+  std::atomic<uint64_t> m_preemptions{0};
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include "behavior_element.hpp"
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+#include <new>
+
+// The children of a composite, fixed once the composite is constructed. Up to INLINE children are
+// held in the list itself; a longer list is allocated once from the memory resource, e.g. a
+// TreeBuilder's arena, with exactly the size needed. The list is the size of the std::pmr::vector
+// it replaces, but keeps no spare capacity and allocates nothing for the short lists most
+// composites have.
+class ChildList {
+public:
+  using Child = std::reference_wrapper<BehaviorElement>;
+  static constexpr std::size_t INLINE = 2;
+
+  ChildList(const Child *children, std::size_t size,
+            std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+      : m_size(size) {
+    if (size <= INLINE) {
+      m_data = reinterpret_cast<Child *>(m_inline);
+    } else {
+      m_mr = mr;
+      m_data = static_cast<Child *>(mr->allocate(size * sizeof(Child), alignof(Child)));
+    }
+    for (std::size_t i = 0; i < size; ++i) {
+      new (m_data + i) Child(children[i]);
+    }
+  }
+
+  ChildList(const ChildList &) = delete;
+  ChildList &operator=(const ChildList &) = delete;
+
+  ~ChildList() {
+    if (!is_inline()) {
+      m_mr->deallocate(m_data, m_size * sizeof(Child), alignof(Child));
+    }
+  }
+
+  const Child *begin() const { return m_data; }
+  const Child *end() const { return m_data + m_size; }
+  const Child *data() const { return m_data; }
+  std::size_t size() const { return m_size; }
+  const Child &operator[](std::size_t i) const { return m_data[i]; }
+
+  // The bytes allocated outside of the list, 0 for an inline list
+  std::size_t heap_bytes() const { return is_inline() ? 0 : m_size * sizeof(Child); }
+
+  // The footprint of every child's subtree
+  Footprint children_footprint() const {
+    Footprint f;
+    for (const auto &c : *this) {
+      f = f + c.get().footprint();
+    }
+    return f;
+  }
+
+private:
+  bool is_inline() const { return m_size <= INLINE; }
+
+  Child *m_data;
+  std::size_t m_size;
+  union {
+    alignas(Child) unsigned char m_inline[INLINE * sizeof(Child)];
+    std::pmr::memory_resource *m_mr; // the resource of a list longer than INLINE
+  };
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <chrono>
+#include <thread>
+
+// Clocks the executor can run on. A clock provides the time stamped into SenseInfo::ts and the
+// sleep between ticks:
+//
+//   time_point now();
+//   void sleep_until(time_point);
+//
+// Both clocks share std::chrono::steady_clock's time_point so elements do not depend on the clock
+// they run on.
+
+// The monotonic wall clock, sleeping really blocks the thread.
+struct SteadyClock {
+  using duration = std::chrono::steady_clock::duration;
+  using time_point = std::chrono::steady_clock::time_point;
+
+  time_point now() const { return std::chrono::steady_clock::now(); }
+  void sleep_until(time_point tp) const { std::this_thread::sleep_until(tp); }
+};
+
+// A virtual clock for faster than real-time runs. Time stands still while an element ticks and
+// sleeping advances the clock instantly to the requested time, so an executor on a SimClock runs
+// its ticks back-to-back while the elements observe the configured period.
+class SimClock {
+public:
+  using duration = std::chrono::steady_clock::duration;
+  using time_point = std::chrono::steady_clock::time_point;
+
+  explicit SimClock(time_point start = time_point{}) : m_now(start) {}
+
+  time_point now() const { return m_now; }
+  void sleep_until(time_point tp) {
+    if (tp > m_now) {
+      m_now = tp;
+    }
+  }
+  void advance(duration d) { m_now += d; }
+
+private:
+  time_point m_now;
+};
@@ -0,0 +1,202 @@
+#pragma once
+#include "element.hpp"
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+// A BehaviorElement written as a C++20 coroutine. The body runs from the first tick, its locals
+// keep their values across ticks, and it suspends where the tick would return Running:
+//
+//   struct Patrol : CoroutineElement {
+//     Patrol() : CoroutineElement("Patrol", reaction_bit(ReactionId_KNEE_JERK)) {}
+//     Task body() override {
+//       while (sense().measured_x < 4) {
+//         actuate({1.0});
+//         co_await next_tick();
+//       }
+//       actuate({0.0});
+//       co_await sleep(std::chrono::seconds{2}); // hold still
+//       co_return Outcome::Return::Success;
+//     }
+//   };
+//
+// Every tick resumes the body until it suspends again; the outcome is Running with the last
+// actuate() command until the body co_returns its result. The time is the sense's timestamp, so a
+// body sleeping on a SimClock sleeps in simulated time. While sleeping the element is not resumed
+// and its WakeCondition tells a reactive executor to skip it until the sleep ends.
+//
+// The coroutine frame is allocated once per initialize() from the element's frame resource. Share a
+// std::pmr::unsynchronized_pool_resource, e.g. TreeBuilder::frames(), between the coroutine
+// elements of a tree and re-running the tree recycles the frames instead of touching the heap;
+// resuming never allocates. Finalizing destroys the frame and the body's locals, even when the body
+// did not complete.
+class CoroutineElement : public BehaviorElement {
+public:
+  class Task;
+
+  struct promise_type {
+    Task get_return_object() {
+      return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    // the body starts on the first tick, not at initialize
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    // the frame is kept to read the result, it is destroyed by the element
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_value(Outcome::Return value) { result = value; }
+    void unhandled_exception() { error = std::current_exception(); }
+
+    // The frame is allocated from the frame resource of the element the body is a member of. The
+    // resource is stored ahead of the frame for the deallocation.
+    template <class Self>
+    static void *operator new(std::size_t size, Self &self) {
+      return allocate(size, static_cast<CoroutineElement &>(self).m_frames);
+    }
+    static void *operator new(std::size_t size) {
+      return allocate(size, std::pmr::get_default_resource());
+    }
+    static void operator delete(void *frame, std::size_t size) {
+      auto *block = static_cast<char *>(frame) - HEADER;
+      auto *mr = *reinterpret_cast<std::pmr::memory_resource **>(block);
+      mr->deallocate(block, size + HEADER, alignof(std::max_align_t));
+    }
+
+    Outcome::Return result{Outcome::Return::Fail};
+    std::exception_ptr error;
+
+  private:
+    static constexpr std::size_t HEADER = alignof(std::max_align_t);
+
+    static void *allocate(std::size_t size, std::pmr::memory_resource *mr) {
+      auto *block = static_cast<char *>(mr->allocate(size + HEADER, alignof(std::max_align_t)));
+      *reinterpret_cast<std::pmr::memory_resource **>(block) = mr;
+      return block + HEADER;
+    }
+  };
+
+  // The coroutine of a body, owning its frame
+  class Task {
+  public:
+    using promise_type = CoroutineElement::promise_type;
+
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+    Task(Task &&o) noexcept : m_handle(std::exchange(o.m_handle, {})) {}
+    Task &operator=(Task &&o) noexcept {
+      if (this != &o) {
+        reset();
+        m_handle = std::exchange(o.m_handle, {});
+      }
+      return *this;
+    }
+    ~Task() { reset(); }
+
+    explicit operator bool() const { return static_cast<bool>(m_handle); }
+    bool done() const { return m_handle.done(); }
+    void resume() { m_handle.resume(); }
+    promise_type &promise() { return m_handle.promise(); }
+    void reset() {
+      if (m_handle) {
+        std::exchange(m_handle, {}).destroy();
+      }
+    }
+
+  private:
+    std::coroutine_handle<promise_type> m_handle{};
+  };
+
+  // @param name the element's name, with static storage duration
+  // @param reactions the reactions enabled while the element executes
+  // @param frames the resource the coroutine frames are allocated from
+  explicit CoroutineElement(const char *name, ReactionSet reactions = 0,
+                            std::pmr::memory_resource *frames = std::pmr::get_default_resource())
+      : m_name(name), m_reactions(reactions), m_frames(frames) {}
+
+  ElementMeta initialize(const Services &svc) final {
+    m_task.reset();
+    m_svcs = &svc;
+    m_actuate = ActuateCmd{};
+    m_resume_at = std::chrono::steady_clock::time_point::min();
+    m_svcs->reaction_svc.activate(m_reactions);
+    m_task = body();
+    return ElementMeta{m_name};
+  }
+
+  Outcome tick(const SenseInfo &s) final {
+    Outcome o;
+    o.value = Outcome::Return::Running;
+
+    m_sense = &s;
+    if (s.ts >= m_resume_at && !m_task.done()) {
+      m_task.resume();
+      if (m_task.promise().error) {
+        std::rethrow_exception(std::exchange(m_task.promise().error, nullptr));
+      }
+    }
+    m_sense = nullptr;
+
+    if (m_task.done()) {
+      o.value = m_task.promise().result;
+    }
+    o.actuate = m_actuate;
+    return o;
+  }
+
+  WakeCondition wake_condition() const final {
+    if (m_resume_at != std::chrono::steady_clock::time_point::min()) {
+      // sleeping, nothing but the time can resume the body
+      return WakeCondition{0, m_resume_at};
+    }
+    return WakeCondition{};
+  }
+
+  void finalize() final {
+    m_task.reset();
+    m_svcs->reaction_svc.release(m_reactions);
+  }
+
+protected:
+  // The element's behavior, started by the first tick after initialize()
+  virtual Task body() = 0;
+
+  // The sense of the tick resuming the body
+  const SenseInfo &sense() const { return *m_sense; }
+  // Sets the command returned by the ticks until it is set again
+  void actuate(const ActuateCmd &cmd) { m_actuate = cmd; }
+
+  const Services::MessengerSvc &messenger() const { return m_svcs->messenger; }
+  const SenseHistory *history() const { return m_svcs->history; }
+
+  struct Suspend {
+    CoroutineElement &element;
+    std::chrono::steady_clock::time_point resume_at;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<>) const noexcept { element.m_resume_at = resume_at; }
+    void await_resume() const noexcept {
+      element.m_resume_at = std::chrono::steady_clock::time_point::min();
+    }
+  };
+
+  // Suspends the body until the next tick
+  Suspend next_tick() { return Suspend{*this, std::chrono::steady_clock::time_point::min()}; }
+
+  // Suspends the body until the first tick dt after the current tick's sense
+  Suspend sleep(std::chrono::nanoseconds dt) {
+    return Suspend{*this, std::chrono::steady_clock::time_point{sense().ts + dt}};
+  }
+
+private:
+  const char *m_name;
+  ReactionSet m_reactions;
+  std::pmr::memory_resource *m_frames;
+
+  const Services *m_svcs{&Services::none()};
+  Task m_task;
+  const SenseInfo *m_sense{nullptr};
+  ActuateCmd m_actuate{};
+  std::chrono::steady_clock::time_point m_resume_at{std::chrono::steady_clock::time_point::min()};
+};
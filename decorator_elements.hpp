@@ -0,0 +1,215 @@
+#pragma once
+#include "behavior_element.hpp"
+#include "profiling.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+// Decorators wrap a single child element and alter its outcome or when it is ticked. The time of a
+// decorator is the sense's timestamp, taken from the executor's clock, so a timeout or rate limit
+// runs in simulated time on a SimClock and every decorator of a tree sees the same time in a tick.
+
+// Common lifecycle of the decorators: the child is initialized on the decorator's first tick and
+// finalized when it completes, or when the decorator is finalized while the child still runs.
+class DecoratorElement : public BehaviorElement {
+public:
+  explicit DecoratorElement(BehaviorElement &child) : m_child(child) {}
+
+  void finalize() override { finalize_child(); }
+
+  WakeCondition wake_condition() const override {
+    if (!m_active) {
+      // the child has to be initialized on the next tick
+      return WakeCondition{};
+    }
+    return m_child.get().wake_condition();
+  }
+
+protected:
+  // The footprint of a decorator of the given size and its child
+  Footprint subtree_footprint(std::size_t bytes) const {
+    return Footprint{bytes, 1, 0} + m_child.get().footprint();
+  }
+
+  void reset(const Services &svc) {
+    m_svcs = &svc;
+    m_active = false;
+  }
+
+  Outcome tick_child(const SenseInfo &s) {
+    if (!m_active) {
+      m_meta = m_child.get().initialize(*m_svcs);
+      m_svcs->lifecycle.emit(LifecycleKind_INITIALIZE, &m_child.get(), m_meta.name);
+      m_active = true;
+    }
+
+    m_svcs->lifecycle.emit(LifecycleKind_TICK, &m_child.get(), m_meta.name);
+    Outcome o;
+    {
+      ProfileScope profile(m_meta.name);
+      o = m_child.get().tick(s);
+    }
+
+    if (o.value != Outcome::Return::Running) {
+      finalize_child(o.value);
+    }
+    return o;
+  }
+
+  // The outcome is the one the child completed with, Running when it is stopped while running
+  void finalize_child(Outcome::Return outcome = Outcome::Return::Running) {
+    if (m_active) {
+      m_child.get().finalize();
+      m_svcs->lifecycle.emit(LifecycleKind_FINALIZE, &m_child.get(), m_meta.name, outcome);
+      m_active = false;
+    }
+  }
+
+  const Services *m_svcs{&Services::none()};
+  std::reference_wrapper<BehaviorElement> m_child;
+
+private:
+  ElementMeta m_meta{};
+  bool m_active{false};
+};
+
+// Turns the child's success into a failure and its failure into a success
+class InverterElement : public DecoratorElement {
+public:
+  using DecoratorElement::DecoratorElement;
+
+  ElementMeta initialize(const Services &svc) override {
+    reset(svc);
+    return ElementMeta{"Inverter"};
+  }
+
+  Footprint footprint() const override { return subtree_footprint(sizeof(*this)); }
+
+  Outcome tick(const SenseInfo &s) override {
+    auto o = tick_child(s);
+    if (o.value == Outcome::Return::Success) {
+      o.value = Outcome::Return::Fail;
+    } else if (o.value == Outcome::Return::Fail) {
+      o.value = Outcome::Return::Success;
+    }
+    return o;
+  }
+
+  ElementStructure structure() const override {
+    return ElementStructure{ElementKind_INVERTER, 1, &m_child};
+  }
+};
+
+// Runs the child again when it fails, up to attempts runs in total. The retry starts on the tick
+// after the failure, the failure's command stays in effect until then. Fails with the last attempt.
+class RetryElement : public DecoratorElement {
+public:
+  static constexpr LogFormat RETRY_FMT{LogLevel::Info, "attempt {} of {} failed"};
+
+  RetryElement(BehaviorElement &child, uint32_t attempts)
+      : DecoratorElement(child), m_attempts(attempts) {}
+
+  ElementMeta initialize(const Services &svc) override {
+    reset(svc);
+    m_failures = 0;
+    return ElementMeta{"Retry"};
+  }
+
+  Footprint footprint() const override { return subtree_footprint(sizeof(*this)); }
+
+  Outcome tick(const SenseInfo &s) override {
+    auto o = tick_child(s);
+    if (o.value == Outcome::Return::Fail && ++m_failures < m_attempts) {
+      m_svcs->messenger.log<RETRY_FMT>("Retry", m_failures, m_attempts);
+      o.value = Outcome::Return::Running;
+    }
+    return o;
+  }
+
+private:
+  uint32_t m_attempts;
+  uint32_t m_failures{0};
+};
+
+// Fails the child once it ran longer than the timeout, measured from the sense of its first tick
+class TimeoutElement : public DecoratorElement {
+public:
+  TimeoutElement(BehaviorElement &child, std::chrono::nanoseconds timeout)
+      : DecoratorElement(child), m_timeout(timeout) {}
+
+  ElementMeta initialize(const Services &svc) override {
+    reset(svc);
+    m_started = false;
+    return ElementMeta{"Timeout"};
+  }
+
+  Footprint footprint() const override { return subtree_footprint(sizeof(*this)); }
+
+  Outcome tick(const SenseInfo &s) override {
+    if (!m_started) {
+      m_started = true;
+      m_start = s.ts;
+    }
+    auto o = tick_child(s);
+    if (o.value == Outcome::Return::Running && s.ts - m_start > m_timeout) {
+      m_svcs->messenger.notify("Timeout", "timeout");
+      finalize_child();
+      o.value = Outcome::Return::Fail;
+    }
+    return o;
+  }
+
+  WakeCondition wake_condition() const override {
+    auto wake = DecoratorElement::wake_condition();
+    if (m_started) {
+      // wake up to fail on the timeout, even when the child would not need a tick
+      wake.deadline = std::min(wake.deadline, m_start + m_timeout + std::chrono::nanoseconds{1});
+    }
+    return wake;
+  }
+
+private:
+  std::chrono::nanoseconds m_timeout;
+  std::chrono::steady_clock::time_point m_start{};
+  bool m_started{false};
+};
+
+// Ticks the child at most once per period. The ticks in between repeat the child's last outcome,
+// so its command stays in effect until the next tick of the child.
+class RateLimitElement : public DecoratorElement {
+public:
+  RateLimitElement(BehaviorElement &child, std::chrono::nanoseconds period)
+      : DecoratorElement(child), m_period(period) {}
+
+  ElementMeta initialize(const Services &svc) override {
+    reset(svc);
+    m_ticked = false;
+    return ElementMeta{"RateLimit"};
+  }
+
+  Footprint footprint() const override { return subtree_footprint(sizeof(*this)); }
+
+  Outcome tick(const SenseInfo &s) override {
+    if (m_ticked && s.ts < m_next) {
+      return m_last;
+    }
+    m_ticked = true;
+    m_next = s.ts + m_period;
+    m_last = tick_child(s);
+    return m_last;
+  }
+
+  WakeCondition wake_condition() const override {
+    if (!m_ticked) {
+      return WakeCondition{};
+    }
+    // nothing but the time lets the child be ticked again
+    return WakeCondition{0, m_next};
+  }
+
+private:
+  std::chrono::nanoseconds m_period;
+  std::chrono::steady_clock::time_point m_next{};
+  Outcome m_last{};
+  bool m_ticked{false};
+};
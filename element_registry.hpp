@@ -0,0 +1,164 @@
+#pragma once
+#include "decorator_elements.hpp"
+#include "element.hpp"
+#include "tree_builder.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+// The arguments of an element constructed from a tree description, see ElementRegistry
+struct ElementArgs {
+  static constexpr std::size_t MAX_PARAMS = 4;
+
+  const double *params;                     // MAX_PARAMS values, 0 when not given
+  const SequenceElement::Elements &children; // the constructed children, in order
+};
+
+// Constructs an element and its storage in the tree's arena. The parameters may come from an
+// untrusted file: a factory throws std::system_error with errc::invalid_argument for parameters
+// its element does not take.
+using ElementFactory = BehaviorElement &(*)(TreeBuilder &tree, const ElementArgs &args);
+
+// A type of element that can be named in a tree description
+struct ElementType {
+  const char *name;      // the element's NAME, with static storage duration
+  ElementFactory factory;
+  uint32_t min_children;
+  uint32_t max_children;
+};
+
+// Maps the names of element types to their factories, for building trees from a description such
+// as a TreeFile rather than in code. The table is filled once at startup and only read afterwards.
+//
+//   auto registry = ElementRegistry::with_composites();
+//   registry.add<WalkToPosition>(); // WalkToPosition(params[0])
+//   registry.add<Stop>();
+//
+// add<T>() registers T::NAME with a factory constructing T from its first parameter when T takes a
+// double, which has to be finite, and with T's default constructor otherwise. Elements taking
+// other arguments register a factory of their own. The parameters an element does not take have
+// to be 0, the value of a parameter not given.
+class ElementRegistry {
+public:
+  static constexpr std::size_t MAX_TYPES = 32;
+  static constexpr uint32_t ANY = UINT32_MAX; // no limit on the number of children
+  static constexpr double MAX_SECONDS = 1e9;  // the longest duration parameter, about 30 years
+
+  // False when the table is full or the name is taken
+  bool add(const char *name, ElementFactory factory, uint32_t min_children = 0,
+           uint32_t max_children = 0) {
+    if (m_size == MAX_TYPES || find(name, std::strlen(name)) != nullptr) {
+      return false;
+    }
+    m_types[m_size++] = ElementType{name, factory, min_children, max_children};
+    return true;
+  }
+
+  template <class T> bool add() { return add(T::NAME, &make<T>); }
+
+  // The type of the name of len characters, null when the name is unknown
+  const ElementType *find(const char *name, std::size_t len) const {
+    for (std::size_t i = 0; i < m_size; ++i) {
+      if (std::strlen(m_types[i].name) == len && std::memcmp(m_types[i].name, name, len) == 0) {
+        return &m_types[i];
+      }
+    }
+    return nullptr;
+  }
+
+  std::size_t size() const { return m_size; }
+
+  // A registry of the composites and decorators: Sequence, Fallback, Inverter, Retry (params:
+  // attempts, a whole number of at least 1), Timeout (params: seconds) and RateLimit (params:
+  // period in seconds). The durations are positive and at most MAX_SECONDS.
+  static ElementRegistry with_composites() {
+    ElementRegistry r;
+    r.add("Sequence", &make_sequence, 0, ANY);
+    r.add("Fallback", &make_fallback, 0, ANY);
+    r.add("Inverter", &make_inverter, 1, 1);
+    r.add("Retry", &make_retry, 1, 1);
+    r.add("Timeout", &make_timeout, 1, 1);
+    r.add("RateLimit", &make_rate_limit, 1, 1);
+    return r;
+  }
+
+private:
+  template <class T> static BehaviorElement &make(TreeBuilder &tree, const ElementArgs &args) {
+    if constexpr (std::is_constructible<T, double>::value) {
+      unused(args, 1, T::NAME);
+      if (!std::isfinite(args.params[0])) {
+        invalid(T::NAME, "parameter");
+      }
+      return tree.make<T>(args.params[0]);
+    } else {
+      unused(args, 0, T::NAME);
+      return tree.make<T>();
+    }
+  }
+
+  [[noreturn]] static void invalid(const char *type, const char *param) {
+    throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                            std::string("invalid ") + param + " of " + type);
+  }
+
+  // Throws for a nonzero parameter after the first used ones, which are all the element takes
+  static void unused(const ElementArgs &args, std::size_t used, const char *type) {
+    for (std::size_t i = used; i < ElementArgs::MAX_PARAMS; ++i) {
+      if (args.params[i] != 0) {
+        invalid(type, "parameters");
+      }
+    }
+  }
+
+  // The parameter as a count, a whole number from 1 to UINT32_MAX. NaN fails every comparison.
+  static uint32_t count(double v, const char *type, const char *param) {
+    if (!(v >= 1 && v <= UINT32_MAX && v == std::floor(v))) {
+      invalid(type, param);
+    }
+    return static_cast<uint32_t>(v);
+  }
+
+  // The parameter as a duration, positive and at most MAX_SECONDS seconds
+  static std::chrono::nanoseconds seconds(double s, const char *type, const char *param) {
+    if (!(s > 0 && s <= MAX_SECONDS)) {
+      invalid(type, param);
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(s));
+  }
+
+  static BehaviorElement &make_sequence(TreeBuilder &tree, const ElementArgs &args) {
+    unused(args, 0, "Sequence");
+    return tree.make<SequenceElement>(args.children, tree.resource());
+  }
+  static BehaviorElement &make_fallback(TreeBuilder &tree, const ElementArgs &args) {
+    unused(args, 0, "Fallback");
+    return tree.make<FallbackElement>(args.children, tree.resource());
+  }
+  static BehaviorElement &make_inverter(TreeBuilder &tree, const ElementArgs &args) {
+    unused(args, 0, "Inverter");
+    return tree.make<InverterElement>(args.children[0].get());
+  }
+  static BehaviorElement &make_retry(TreeBuilder &tree, const ElementArgs &args) {
+    unused(args, 1, "Retry");
+    return tree.make<RetryElement>(args.children[0].get(),
+                                   count(args.params[0], "Retry", "attempts"));
+  }
+  static BehaviorElement &make_timeout(TreeBuilder &tree, const ElementArgs &args) {
+    unused(args, 1, "Timeout");
+    return tree.make<TimeoutElement>(args.children[0].get(),
+                                     seconds(args.params[0], "Timeout", "seconds"));
+  }
+  static BehaviorElement &make_rate_limit(TreeBuilder &tree, const ElementArgs &args) {
+    unused(args, 1, "RateLimit");
+    return tree.make<RateLimitElement>(args.children[0].get(),
+                                       seconds(args.params[0], "RateLimit", "period"));
+  }
+
+  ElementType m_types[MAX_TYPES]{};
+  std::size_t m_size{0};
+};
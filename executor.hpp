@@ -1,34 +1,233 @@
 #pragma once
-#include "element.hpp"
-#include <thread>
+#include "alloc_check.hpp"
+#include "behavior_element.hpp"
+#include "cancellation.hpp"
+#include "profiling.hpp"
+#include "scheduler.hpp"
+#include "sense_history.hpp"
+
+// Robot I/O of an executor without a robot: the sense is simulated from the commanded velocity,
+// integrated over the time between two ticks. Executors run without an I/O use it.
+//
+// An executor's I/O provides the sense each tick works on and takes the tick's command:
+//
+//   const SenseInfo &sense(time_point now); // the sample to tick with, valid until the next call
+//   void actuate(const ActuateCmd &cmd, time_point now);
+//
+// See ChannelIo for the I/O of a robot whose sensors are read by their own thread.
+class SimulatedIo {
+public:
+  using time_point = std::chrono::steady_clock::time_point;
+
+  // The robot starts from the initial sense, its timestamp is replaced by the time of the first tick
+  explicit SimulatedIo(const SenseInfo &initial = {}) : m_sense(initial) {}
+
+  const SenseInfo &sense(time_point now) {
+    if (m_started) {
+      simulate_walk(m_sense, m_cmd, now);
+    } else {
+      m_sense.ts = now;
+      m_started = true;
+    }
+    return m_sense;
+  }
+
+  void actuate(const ActuateCmd &cmd, time_point) { m_cmd = cmd; }
+
+  // The sense of the last tick
+  const SenseInfo &current() const { return m_sense; }
+
+  // Simulates the robot walking with the commanded velocity from the sense's timestamp until now
+  static void simulate_walk(SenseInfo &sense, const ActuateCmd &cmd, time_point now) {
+    std::chrono::duration<double> dt = now - sense.ts;
+    sense.ts = now;
+    sense.measured_x += cmd.velocity * dt.count();
+    sense.measured_velocity = cmd.velocity;
+  }
+
+private:
+  SenseInfo m_sense{};
+  ActuateCmd m_cmd{};
+  bool m_started{false};
+};
+
+// One run of an element, advanced tick by tick by its owner: Executor::run drives it from a
+// PeriodicScheduler, an event loop can drive it from a timer callback instead. The run keeps the
+// sense history shared with the elements and skips the ticks of a reactive run while the element's
+// WakeCondition is not met.
+template <class Io> class ExecutorRun {
+public:
+  static constexpr LogFormat REACTIVE_FMT{LogLevel::Info, "ticked={} idle={}"};
+  static constexpr LogFormat ALLOC_FMT{LogLevel::Warn, "heap allocations while ticking={}"};
+
+  ExecutorRun(BehaviorElement &element, Services svc, Io &io, bool reactive = false)
+      : m_element(&element), m_svcs(svc), m_io(io), m_reactive(reactive) {
+    m_svcs.history = &m_history;
+  }
+
+  ExecutorRun(const ExecutorRun &) = delete;
+  ExecutorRun &operator=(const ExecutorRun &) = delete;
+
+  // Initializes the element
+  void start() {
+    m_meta = m_element->initialize(m_svcs);
+    m_svcs.lifecycle.emit(LifecycleKind_INITIALIZE, m_element, m_meta.name);
+    m_first = true;
+    m_ticked = 0;
+    m_idle = 0;
+    m_allocations = alloc_check::violations();
+  }
+
+  // Ticks the element with the I/O's sense at now and hands the command to the I/O. The command is
+  // applied until the next step. With BEHAVIOR_NO_ALLOC_CHECK the heap allocations of the step are
+  // flagged, see alloc_check.hpp.
+  Outcome step(std::chrono::steady_clock::time_point now) {
+    NoAllocScope no_alloc;
+    const SenseInfo &sense = m_io.sense(now);
+    m_history.push(sense);
+    m_svcs.trace.sense(sense);
+    m_svcs.lifecycle.now = sense.ts;
+
+    // a reactive run only ticks when the element's wake condition is met, otherwise the previous
+    // outcome stays in effect
+    if (!m_reactive || m_first || sense.ts >= m_wake.deadline ||
+        sense_changed(m_wake.sense_mask, m_ticked_sense, sense)) {
+      m_svcs.lifecycle.emit(LifecycleKind_TICK, m_element, m_meta.name);
+      {
+        ProfileScope profile(m_meta.name);
+        m_out = m_element->tick(sense);
+      }
+      m_svcs.trace.outcome(m_meta.name, m_out);
+      if (m_reactive) {
+        m_wake = m_element->wake_condition();
+        m_ticked_sense = sense;
+      }
+      m_first = false;
+      ++m_ticked;
+    } else {
+      ++m_idle;
+    }
+
+    m_io.actuate(m_out.actuate, now);
+    return m_out;
+  }
+
+  // Finalizes the element
+  void stop() {
+    m_element->finalize();
+    m_svcs.lifecycle.emit(LifecycleKind_FINALIZE, m_element, m_meta.name, m_out.value);
+    if (m_reactive) {
+      m_svcs.messenger.log<REACTIVE_FMT>(m_meta.name, m_ticked, m_idle);
+    }
+#if BEHAVIOR_NO_ALLOC_CHECK
+    if (auto allocations = alloc_check::violations() - m_allocations; allocations > 0) {
+      m_svcs.messenger.log<ALLOC_FMT>(m_meta.name, allocations);
+    }
+#endif
+  }
+
+  // Hands the run over to another element: the running element is stopped, its running chain
+  // finalized, and next is started. The next step ticks next with the same I/O and history.
+  void preempt(BehaviorElement &next) {
+    stop();
+    m_element = &next;
+    start();
+  }
+
+  const ElementMeta &meta() const { return m_meta; }
+  Services &services() { return m_svcs; }
+  const Outcome &outcome() const { return m_out; }
+
+private:
+  BehaviorElement *m_element;
+  Services m_svcs;
+  Io &m_io;
+  bool m_reactive;
+  SenseHistory m_history;
+  ElementMeta m_meta{};
+  Outcome m_out{};
+  WakeCondition m_wake{};
+  SenseInfo m_ticked_sense{};
+  bool m_first{true};
+  uint64_t m_ticked{0};
+  uint64_t m_idle{0};
+  uint64_t m_allocations{0}; // the allocation violations before the run started
+};
 
 struct Executor {
-  static void run(BehaviorElement &element) {
-    // Establish our Services and our Sense Input
-    Services svc;
+  static constexpr LogFormat OVERRUN_FMT{LogLevel::Warn, "overruns={} skipped={}"};
+
+  // Runs the element to completion on the wall clock
+  static Outcome run(BehaviorElement &element, const TickSchedule &schedule = {},
+                     Services svc = {}) {
+    SteadyClock clock;
+    return run(element, schedule, svc, clock);
+  }
+
+  // Runs the element on the wall clock until it completes or the token cancels the run, see
+  // CancelToken
+  static Outcome run(BehaviorElement &element, const TickSchedule &schedule, Services svc,
+                     CancelToken &token) {
+    SteadyClock clock;
+    SimulatedIo io;
+    return run(element, schedule, svc, clock, io, &token);
+  }
+
+  // Runs the element to completion on the given clock, e.g. a SimClock for faster than real-time
+  // simulations. The sense is simulated, its timestamps are taken from the clock.
+  template <class Clock>
+  static Outcome run(BehaviorElement &element, const TickSchedule &schedule, Services svc,
+                     Clock &clock) {
+    SimulatedIo io;
+    return run(element, schedule, svc, clock, io);
+  }
+
+  // Runs the element to completion on the given clock and robot I/O. Every tick is handed the I/O's
+  // sense sample by reference, e.g. the latest sample of a SenseChannel in place. With a token the
+  // run is preempted or cancelled through it at the start of a tick.
+  template <class Clock, class Io>
+  static Outcome run(BehaviorElement &element, const TickSchedule &schedule, Services svc,
+                     Clock &clock, Io &io, CancelToken *token = nullptr) {
+    ExecutorRun<Io> run(element, svc, io, schedule.reactive);
+    PeriodicScheduler<Clock> scheduler(schedule, clock);
+    auto now = clock.now();
+
+#if BEHAVIOR_PROFILING
+    Profiler::global().set_deadline(schedule.period);
+#endif
+
+    // run the element until done, waiting for the next deadline between the ticks
+    run.start();
     Outcome out;
-    SenseInfo sense;
-    sense.ts = std::chrono::steady_clock::now();
-
-    // init the element
-    auto meta = element.initialize(svc);
-    svc.messenger.notify(meta.name, "initialize");
-
-    // run the element until done
-    do {
-      sense.ts = std::chrono::steady_clock::now();
-      svc.messenger.notify(meta.name, "tick");
-      out = element.tick(sense);
-
-      // simulate walking
-      constexpr std::chrono::milliseconds period{100};
-      sense.measured_x += out.actuate.velocity * period.count() / 1000.0;
-      sense.measured_velocity = out.actuate.velocity;
-      std::this_thread::sleep_for(std::chrono::milliseconds{100});
-    } while (out.value == Outcome::Return::Running);
-
-    // finalize
-    element.finalize();
-    svc.messenger.notify(meta.name, "finalize");
-  }
-};
\ No newline at end of file
+    for (;;) {
+      if (token != nullptr) {
+        if (token->cancelled()) {
+          out.value = Outcome::Return::Running;
+          break;
+        }
+        if (auto *next = token->take_preemption()) {
+          run.preempt(*next);
+          token->preempted();
+        }
+      }
+      out = run.step(now);
+      if (out.value != Outcome::Return::Running) {
+        break;
+      }
+      now = scheduler.wait_next();
+    }
+    run.stop();
+
+    if (scheduler.overruns() > 0) {
+      run.services().messenger.template log<OVERRUN_FMT>(run.meta().name, scheduler.overruns(),
+                                                         scheduler.skipped());
+    }
+    return out;
+  }
+
+  // Simulates the robot walking with the commanded velocity from the sense's timestamp until now
+  static void simulate_walk(SenseInfo &sense, const ActuateCmd &cmd,
+                            std::chrono::steady_clock::time_point now) {
+    SimulatedIo::simulate_walk(sense, cmd, now);
+  }
+};
@@ -0,0 +1,237 @@
+#pragma once
+#include "behavior_element.hpp"
+#include "profiling.hpp"
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+// A behavior tree compiled into one flat array of nodes. The composites found through
+// BehaviorElement::structure(), sequences, fallbacks and inverters, become nodes of the array in
+// preorder: the children of a node follow it, and every node knows its parent and where its subtree
+// ends, which is where its next sibling starts. Every other element is a leaf node ticked through
+// its BehaviorElement interface, e.g. a MotionElement, or a parallel or retry still owning its
+// subtree.
+//
+// A tick is a loop instead of a recursion through the composites' virtual ticks: it follows the
+// running child of each composite down to the running leaf, ticks the leaf, and walks the leaf's
+// outcome back up the way it came only as far as a composite completes. The per-node state, the
+// running child of each composite, is one contiguous array next to the nodes. The cost of a tick
+// follows the length of the running path, not the tree's pointer structure.
+//
+//   SequenceElement mission({...});
+//   FlatTree flat(mission);
+//   Executor::run(flat);
+//
+// The compiled tree behaves like the tree it was compiled from, its lifecycle notifications
+// included. The source composites are not used by the flat tree and must not be ticked while it
+// runs, the leaves are shared.
+class FlatTree : public BehaviorElement {
+public:
+  static constexpr uint32_t NEW = UINT32_MAX; // the node is started on its next tick
+
+  struct Node {
+    BehaviorElement *element; // the source element, ticked when the node is a leaf
+    const char *name;         // the element's name, a leaf's from its initialize
+    uint32_t parent;          // the root is its own parent
+    uint32_t end;             // one past the last node of the subtree, the next sibling
+    ElementKind kind;
+  };
+
+  explicit FlatTree(BehaviorElement &root,
+                    std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+      : m_nodes(mr), m_state(mr) {
+    compile(root);
+  }
+
+  ElementMeta initialize(const Services &svc) override {
+    m_svcs = &svc;
+    m_state[0] = NEW;
+    if (m_nodes[0].kind == ElementKind_LEAF) {
+      // a single leaf, the flat tree is the leaf
+      m_nodes[0].name = m_nodes[0].element->initialize(*m_svcs).name;
+      m_state[0] = 0;
+    }
+    return ElementMeta{m_nodes[0].name};
+  }
+
+  Outcome tick(const SenseInfo &s) override {
+    Outcome o;
+
+    // descend the running path, starting the nodes that are new. The root's lifecycle is announced
+    // by the flat tree's owner.
+    uint32_t node = 0;
+    for (;;) {
+      auto &n = m_nodes[node];
+      bool start = m_state[node] == NEW;
+      if (start && n.kind == ElementKind_LEAF) {
+        n.name = n.element->initialize(*m_svcs).name;
+        m_state[node] = 0;
+      }
+      if (node != 0) {
+        if (start) {
+          announce(node, LifecycleKind_INITIALIZE);
+        }
+        announce(node, LifecycleKind_TICK);
+      }
+
+      if (n.kind == ElementKind_LEAF) {
+        ProfileScope profile(n.name);
+        o = n.element->tick(s);
+        break;
+      }
+      if (start) {
+        if (n.end == node + 1) {
+          // we arrive here when the composite never had any elements
+          o.value = Outcome::Return::Fail;
+          break;
+        }
+        m_state[node] = node + 1;
+        m_state[node + 1] = NEW;
+      }
+      node = m_state[node];
+    }
+
+    // ascend while the children complete
+    while (node != 0 && o.value != Outcome::Return::Running) {
+      finalize_node(node, o.value);
+
+      auto parent = m_nodes[node].parent;
+      auto &p = m_nodes[parent];
+      if (p.kind == ElementKind_INVERTER) {
+        o.value = invert(o.value);
+      } else {
+        auto continue_on =
+            p.kind == ElementKind_SEQUENCE ? Outcome::Return::Success : Outcome::Return::Fail;
+        auto next = m_nodes[node].end;
+        if (next < p.end && o.value == continue_on) {
+          // maintain that the composite is still running, the next child takes over
+          m_state[parent] = next;
+          m_state[next] = NEW;
+          o.value = Outcome::Return::Running;
+        }
+      }
+      node = parent;
+    }
+    return o;
+  }
+
+  // The flat tree, its arrays and the leaves it ticks. The composites it was compiled from are not
+  // counted, the flat tree does not tick them.
+  Footprint footprint() const override {
+    Footprint f{sizeof(*this) + m_nodes.capacity() * sizeof(Node) +
+                    m_state.capacity() * sizeof(uint32_t),
+                1, 0};
+    for (const auto &n : m_nodes) {
+      if (n.kind == ElementKind_LEAF) {
+        f = f + n.element->footprint();
+      }
+    }
+    return f;
+  }
+
+  WakeCondition wake_condition() const override {
+    uint32_t node = 0;
+    for (;;) {
+      if (m_state[node] == NEW) {
+        // the node has to be started on the next tick
+        return WakeCondition{};
+      }
+      if (m_nodes[node].kind == ElementKind_LEAF) {
+        return m_nodes[node].element->wake_condition();
+      }
+      node = m_state[node];
+    }
+  }
+
+  void finalize() override {
+    if (m_state[0] == NEW) {
+      return;
+    }
+    // follow the running path to its deepest started node and finalize it and its ancestors in
+    // turn, as the composites finalizing their running child would
+    uint32_t node = 0;
+    while (m_nodes[node].kind != ElementKind_LEAF && m_state[m_state[node]] != NEW) {
+      node = m_state[node];
+    }
+    for (; node != 0; node = m_nodes[node].parent) {
+      finalize_node(node);
+    }
+    finalize_node(0);
+  }
+
+  const std::pmr::vector<Node> &nodes() const { return m_nodes; }
+
+private:
+  static Outcome::Return invert(Outcome::Return r) {
+    return r == Outcome::Return::Success ? Outcome::Return::Fail : Outcome::Return::Success;
+  }
+
+  static const char *kind_name(ElementKind kind) {
+    switch (kind) {
+    case ElementKind_SEQUENCE:
+      return "Sequence";
+    case ElementKind_FALLBACK:
+      return "Fallback";
+    case ElementKind_INVERTER:
+      return "Inverter";
+    default:
+      return nullptr;
+    }
+  }
+
+  // Appends the subtree in preorder, keeping the nodes still to be visited on an explicit stack
+  void compile(BehaviorElement &root) {
+    struct Pending {
+      BehaviorElement *element;
+      uint32_t parent;
+    };
+    std::vector<Pending> stack{{&root, 0}};
+    std::vector<uint32_t> open; // the composites whose subtree end is not known yet
+
+    while (!stack.empty()) {
+      auto [element, parent] = stack.back();
+      stack.pop_back();
+
+      auto index = static_cast<uint32_t>(m_nodes.size());
+      // the subtrees before this node are complete
+      while (!open.empty() && open.back() != parent) {
+        m_nodes[open.back()].end = index;
+        open.pop_back();
+      }
+
+      auto st = element->structure();
+      m_nodes.push_back(Node{element, kind_name(st.kind), parent, index + 1, st.kind});
+      if (st.kind != ElementKind_LEAF) {
+        open.push_back(index);
+        for (std::size_t i = st.size; i-- > 0;) {
+          stack.push_back(Pending{&st.children[i].get(), index});
+        }
+      }
+    }
+    for (auto index : open) {
+      m_nodes[index].end = static_cast<uint32_t>(m_nodes.size());
+    }
+    m_state.assign(m_nodes.size(), NEW);
+  }
+
+  void announce(uint32_t node, LifecycleKind kind,
+                Outcome::Return outcome = Outcome::Return::Running) {
+    m_svcs->lifecycle.emit(kind, m_nodes[node].element, m_nodes[node].name, outcome);
+  }
+
+  // The outcome is the one the node completed with, Running when it is finalized while running
+  void finalize_node(uint32_t node, Outcome::Return outcome = Outcome::Return::Running) {
+    if (m_nodes[node].kind == ElementKind_LEAF) {
+      m_nodes[node].element->finalize();
+    }
+    m_state[node] = NEW;
+    if (node != 0) {
+      announce(node, LifecycleKind_FINALIZE, outcome);
+    }
+  }
+
+  const Services *m_svcs{&Services::none()};
+  std::pmr::vector<Node> m_nodes;
+  std::pmr::vector<uint32_t> m_state; // a composite's running child, NEW until started
+};
@@ -0,0 +1,152 @@
+#include "decorator_elements.hpp"
+#include "element.hpp"
+#include "executor.hpp"
+#include "flat_tree.hpp"
+#include "tree_builder.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+
+// Checks that a FlatTree behaves like the tree it was compiled from. Random trees of sequences,
+// fallbacks and inverters over scripted leaves are run twice, nested and compiled, and the outcomes,
+// commands and lifecycle notifications of both runs have to be the same. The runs are preempted
+// after a varying number of ticks, so the finalization of a running chain is compared as well.
+
+namespace {
+
+constexpr int SEEDS = 3000;
+constexpr int ROUNDS = 3;     // runs of the same tree, re-initialized after each preemption
+constexpr int MAX_TICKS = 24; // the ticks of the tree taking over after a preemption
+
+// A leaf running for a number of ticks and then succeeding or failing, alternating between runs
+class Script : public BehaviorElement {
+public:
+  Script(const char *name, int ticks, bool succeed)
+      : m_name(name), m_ticks(ticks), m_succeed(succeed) {}
+
+  ElementMeta initialize(const Services &) override {
+    m_ticked = 0;
+    ++m_runs;
+    return {m_name};
+  }
+
+  Outcome tick(const SenseInfo &) override {
+    Outcome o;
+    o.actuate.velocity = m_ticks + m_runs;
+    if (++m_ticked < m_ticks) {
+      o.value = Outcome::Return::Running;
+    } else {
+      o.value = m_succeed != (m_runs % 2 == 0) ? Outcome::Return::Success : Outcome::Return::Fail;
+    }
+    return o;
+  }
+
+  void finalize() override {}
+
+private:
+  const char *m_name;
+  int m_ticks;
+  bool m_succeed;
+  int m_ticked{0};
+  int m_runs{0};
+};
+
+class Recorder : public LifecycleSubscriber {
+public:
+  void on_lifecycle(const LifecycleEvent &e) override {
+    m_out << e.name << ':' << e.kind << ':' << static_cast<int>(e.outcome) << '\n';
+  }
+
+  std::string str() const { return m_out.str(); }
+
+private:
+  std::ostringstream m_out;
+};
+
+const char *const NAMES[] = {"a", "b", "c", "d", "e", "f", "g", "h"};
+
+BehaviorElement &random_tree(TreeBuilder &tree, std::mt19937 &rng, int depth = 0) {
+  auto kind = depth > 4 ? 0 : rng() % 4;
+  if (kind == 0) {
+    return tree.make<Script>(NAMES[rng() % 8], 1 + static_cast<int>(rng() % 3), rng() % 2 == 0);
+  }
+  if (kind == 3) {
+    return tree.make<InverterElement>(random_tree(tree, rng, depth + 1));
+  }
+  SequenceElement::Elements children(tree.resource());
+  for (auto n = rng() % 4; n > 0; --n) {
+    children.push_back(random_tree(tree, rng, depth + 1));
+  }
+  if (kind == 1) {
+    return tree.make<SequenceElement>(children, tree.resource());
+  }
+  return tree.make<FallbackElement>(children, tree.resource());
+}
+
+// Runs the tree for ticks ticks, or until it completes, and preempts it with next, which runs to
+// completion. Returns what the runs did.
+std::string run(BehaviorElement &tree, BehaviorElement &next, int ticks) {
+  Recorder recorder;
+  Services svc;
+  svc.messenger.threshold = LogLevel::Off;
+  svc.lifecycle.subscribe(&recorder);
+
+  std::ostringstream out;
+  auto now = std::chrono::steady_clock::time_point{};
+  auto step = [&](ExecutorRun<SimulatedIo> &r) {
+    auto o = r.step(now);
+    now += std::chrono::milliseconds{10};
+    out << static_cast<int>(o.value) << ',' << o.actuate.velocity << ' ';
+    return o.value == Outcome::Return::Running;
+  };
+
+  for (int round = 0; round < ROUNDS; ++round) {
+    SimulatedIo io;
+    ExecutorRun<SimulatedIo> r(tree, svc, io);
+    r.start();
+    for (int i = 0; i < ticks && step(r); ++i) {
+    }
+    out << "| ";
+    r.preempt(next);
+    for (int i = 0; i < MAX_TICKS && step(r); ++i) {
+    }
+    r.stop();
+    out << "\n";
+  }
+  return out.str() + recorder.str();
+}
+
+} // namespace
+
+int main() {
+  int failed = 0;
+  for (int seed = 0; seed < SEEDS; ++seed) {
+    int ticks = 1 + seed % 13;
+
+    // the scripts count their runs, each run gets trees of its own
+    std::mt19937 rng(seed);
+    TreeBuilder nested_tree;
+    auto &nested = random_tree(nested_tree, rng);
+    auto &nested_next = random_tree(nested_tree, rng);
+    auto expected = run(nested, nested_next, ticks);
+
+    rng.seed(seed);
+    TreeBuilder flat_tree;
+    auto &source = random_tree(flat_tree, rng);
+    auto &source_next = random_tree(flat_tree, rng);
+    FlatTree flat(source);
+    FlatTree flat_next(source_next);
+    auto actual = run(flat, flat_next, ticks);
+
+    if (actual != expected) {
+      if (failed == 0) {
+        std::printf("seed %d\nnested:\n%s\nflat:\n%s\n", seed, expected.c_str(), actual.c_str());
+      }
+      ++failed;
+    }
+  }
+  std::printf("%d of %d trees differ\n", failed, SEEDS);
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <type_traits>
+
+// Severity of a log statement
+enum class LogLevel : uint8_t { Debug, Info, Warn, Error, Off };
+
+// Log statements below this level are removed at compile time. Define BEHAVIOR_LOG_LEVEL as the
+// numeric value of a LogLevel, e.g. -DBEHAVIOR_LOG_LEVEL=1 to compile out the Debug statements.
+#ifndef BEHAVIOR_LOG_LEVEL
+#define BEHAVIOR_LOG_LEVEL 0
+#endif
+constexpr LogLevel COMPILED_LOG_LEVEL = static_cast<LogLevel>(BEHAVIOR_LOG_LEVEL);
+
+// A compile-time log format. Each '{}' in the text is replaced with the next argument when the
+// record is formatted. The address of the format identifies it, so a format must be declared with
+// static storage duration, e.g. as a static constexpr member of the element.
+struct LogFormat {
+  LogLevel level;
+  const char *text;
+};
+
+// A raw, unformatted log argument.
+struct LogArg {
+  enum class Type : uint8_t { Double, Int, Str };
+
+  Type type;
+  union {
+    double d;
+    int64_t i;
+    const char *s; // must have static storage duration, it is read after the call returns
+  };
+};
+
+// A deferred log statement: the format and the raw argument values. Records are trivially copyable
+// and formatted only when a sink writes them.
+struct LogRecord {
+  static constexpr std::size_t MAX_ARGS = 4;
+
+  const LogFormat *fmt;
+  uint8_t nargs;
+  LogArg args[MAX_ARGS];
+};
+
+template <class T> LogArg make_log_arg(T value) {
+  LogArg a;
+  if constexpr (std::is_floating_point<T>::value) {
+    a.type = LogArg::Type::Double;
+    a.d = value;
+  } else if constexpr (std::is_integral<T>::value) {
+    a.type = LogArg::Type::Int;
+    a.i = static_cast<int64_t>(value);
+  } else {
+    static_assert(std::is_convertible<T, const char *>::value,
+                  "log arguments must be floating point, integral, or const char*");
+    a.type = LogArg::Type::Str;
+    a.s = value;
+  }
+  return a;
+}
+
+template <class... Args>
+LogRecord make_log_record(const LogFormat &fmt, Args... args) {
+  static_assert(sizeof...(Args) <= LogRecord::MAX_ARGS, "too many log arguments");
+  LogRecord r{&fmt, static_cast<uint8_t>(sizeof...(Args)), {make_log_arg(args)...}};
+  return r;
+}
+
+// Formats the record's text, substituting the arguments in order
+std::ostream &write_log(std::ostream &out, const LogRecord &r);
+
+// The console, where a messenger without a backend writes to, and the writes of such a messenger.
+// Defined in messenger.cpp, which keeps <iostream> out of the headers.
+std::ostream &console_stream();
+void console_write(const char *source, const char *msg, std::size_t len);
+void console_write(const char *source, const LogRecord &record);
@@ -1,104 +1,127 @@
+#include "async_messenger.hpp"
 #include "element.hpp"
 #include "executor.hpp"
+#include "motion_elements.hpp"
+#include "realtime.hpp"
+#include "tree_file.hpp"
+#include <atomic>
+#include <csignal>
+#include <cstring>
 #include <future>
+#include <iostream>
+
+// flags the heap allocations of the tick thread when built with DFS_NO_ALLOC_CHECK
+BEHAVIOR_ALLOC_HOOKS();
+
+static constexpr LogFormat REALTIME_FMT{LogLevel::Warn,
+                                        "realtime setup failed: scheduler={} affinity={} mlock={}"};
+static constexpr LogFormat FOOTPRINT_FMT{LogLevel::Info, "tree bytes={} elements={}"};
+
+// the RAM budget of the behavior, checked when building for the target
+static constexpr std::size_t TREE_BUDGET = 256;
+static_assert(TREE_BYTES<Stop, WalkToPosition, SequenceElement> <= TREE_BUDGET,
+              "the behavior exceeds its RAM budget");
+
+// stops the run on Ctrl-C, finalizing the running elements
+static CancelToken g_cancel;
+extern "C" void on_interrupt(int) { g_cancel.cancel(); }
+
+// reloads the mission file on SIGHUP
+static std::atomic<bool> g_reload{false};
+extern "C" void on_hangup(int) { g_reload.store(true); }
+
+// Usage: dfs [--realtime] [mission.tree] runs the behavior below, or the tree file, reloaded on
+//          SIGHUP, with --realtime the tick thread runs at SCHED_FIFO priority, locked in memory
+//        dfs --save mission.tree writes the behavior below as a tree file
+int main(int argc, char **argv) {
+  bool realtime_run = argc > 1 && std::strcmp(argv[1], "--realtime") == 0;
+  if (realtime_run) {
+    --argc;
+    ++argv;
+  }
 
-// This element commands the robot to stop its motion. The element does not
-// complete until motion has stopped.
-struct Stop : public MotionElement<Stop> {
-  // Compile Time Configuration
-  static constexpr char const *const NAME = "Stop";
-  static constexpr ReactionDef KNEE_JERK_REACTION = ReactionDef_ENABLED;
-  static constexpr ReactionDef FLINCH_REACTION = ReactionDef_ENABLED;
-
-  static Outcome motion_element_tick(Stop &me, const SenseInfo &in) {
-    Outcome out;
-
-    bool is_zero = std::numeric_limits<double>::epsilon() >=
-                   std::abs(in.measured_velocity);
-
-    out.value = is_zero ? Outcome::Return::Success : Outcome::Return::Running;
-    out.actuate.velocity = 0;
+  // Create the behavior -> walk then stop
+  Stop stop;
+  WalkToPosition walk(4);
+  SequenceElement sequence({std::ref(walk), std::ref(stop)});
 
-    return out;
-  }
-};
-
-// The WalkToPosition element walks the robot along the x-axis towards the goal
-// provided to the element
-struct WalkToPosition : public MotionElement<WalkToPosition> {
-  /// Constructor accepts the element's goal and additional params
-  /// @param goal the absolute x coordinate in meters
-  WalkToPosition(double goal) : goal_x(goal) {}
-
-  // MotionElement Compile Time Requirements
-  static constexpr char const *const NAME = "WalkToPosition";
-  static constexpr ReactionDef FLINCH_REACTION =
-      ReactionDef_DISABLED; // we don't care if we flinch while walking
-  static constexpr ReactionDef KNEE_JERK_REACTION = ReactionDef_ENABLED;
-
-  // MotionElement Static Overrides
-  static void motion_element_data_initialize(WalkToPosition &me,
-                                             const SenseInfo &s) {
-    me.init_ts = s.ts;
+  if (argc == 3 && std::strcmp(argv[1], "--save") == 0) {
+    write_tree_file(argv[2],
+                    TreeSpec{"Sequence", {}, {{"WalkToPosition", {4}, {}}, {"Stop", {}, {}}}});
+    return 0;
   }
 
-  // Tick Implementation
-  static Outcome motion_element_tick(WalkToPosition &me, const SenseInfo &s) {
-    // method constants
-    static constexpr double MY_VELO = 1.0;        // m/s
-    static constexpr double GOAL_THRESHOLD = 0.1; // m
-    static constexpr std::chrono::milliseconds TIMEOUT{60000};
-
-    Outcome o;
-    // Always set the velocity, even if we are done
-    // The next element will take control, ensuring there are no jerks between
-    // elements
-    o.actuate.velocity = MY_VELO;
-    o.value = Outcome::Return::Running;
-
-    // Determine the error between goal and measured and apply our control
-    // command (velocity)
-    auto dist_x = me.goal_x - s.measured_x;
-    o.actuate.velocity = dist_x >= 0 ? MY_VELO : -MY_VELO;
-
-    // Evaluate the exit conditions and adjust the actuate info if needed
-    if (std::abs(dist_x) < GOAL_THRESHOLD) {
-      // we reached the target successfully
-      me.messenger().notify(NAME, "goal reached");
-      o.value = Outcome::Return::Success;
-    } else if (s.ts - me.init_ts > TIMEOUT) {
-      // fail on timeout
-      me.messenger().notify(NAME, "timeout");
-      o.value = Outcome::Return::Fail;
-    } else if (s.is_knee_jerking) {
-      // for safety set the vel to 0 even though the reflex is in command now.
-      // continue running, otherwise
-      o.actuate.velocity = 0;
-    } else {
-      me.messenger().notify(NAME,
-                            "velocity=" + std::to_string(o.actuate.velocity) +
-                                " pos=" + std::to_string(s.measured_x) +
-                                " dist=" + std::to_string(dist_x) +
-                                " goal=" + std::to_string(me.goal_x));
-    }
-
-    return o;
+  // the elements a tree file can name
+  auto registry = ElementRegistry::with_composites();
+  registry.add<WalkToPosition>();
+  registry.add<Stop>();
+
+  const char *mission_path = argc == 2 ? argv[1] : nullptr;
+  TreeSwap missions(registry, g_cancel);
+  BehaviorElement &root = mission_path ? missions.load(mission_path) : sequence;
+
+  // tick at a fixed 10Hz rate
+  TickSchedule schedule;
+  schedule.period = std::chrono::milliseconds{100};
+
+  // keep the console output off of the tick thread
+  AsyncMessenger messenger;
+  Services svc;
+  svc.messenger.backend = &messenger;
+  // print the elements' lifecycle transitions
+  LifecycleLog lifecycle_log(svc.messenger);
+  svc.lifecycle.subscribe(&lifecycle_log);
+
+  // the reactions muted by the behavior, queried by the reflex layer from its own thread
+  ReactionState reactions;
+  svc.reaction_svc.state = &reactions;
+
+  // with --realtime, keep the tick thread ahead of the mapping and planning threads and free of
+  // page faults. Without the privileges the settings that fail are reported and the run goes on
+  // without them.
+  RealtimeOptions realtime;
+  if (realtime_run) {
+    realtime.priority = 80;
+    realtime.lock_memory = true;
+    realtime.prefault_stack = 256 * 1024;
   }
 
-private:
-  double goal_x{};
-  std::chrono::steady_clock::time_point init_ts;
-};
+  auto footprint = root.footprint();
+  svc.messenger.log<FOOTPRINT_FMT>("main", footprint.bytes, footprint.elements);
 
-int main(int, char **) {
-  // Create the behavior -> walk then stop
-  Stop stop;
-  WalkToPosition walk(4);
-  SequenceElement sequence({std::ref(walk), std::ref(stop)});
+  std::signal(SIGINT, on_interrupt);
+  std::signal(SIGHUP, on_hangup);
 
   // run it asynchronously so we can do other work, like mapping or planning
-  auto result = std::async(Executor::run, std::ref(sequence));
-  result.wait();
+  auto result = std::async(std::launch::async, [&] {
+    auto status = apply_realtime(realtime);
+    if (!status.ok()) {
+      svc.messenger.log<REALTIME_FMT>("main", status.scheduler, status.affinity,
+                                      status.memory_lock);
+    }
+    return Executor::run(root, schedule, svc, g_cancel);
+  });
+
+  // the main thread reports to the console directly, the async messenger's only producer is the
+  // tick thread
+  Services main_svc;
+
+  // swap the mission at the next tick when the file is reloaded, the run goes on with it
+  while (result.wait_for(std::chrono::milliseconds{100}) != std::future_status::ready) {
+    if (mission_path != nullptr && g_reload.exchange(false)) {
+      try {
+        if (!missions.swap(mission_path)) {
+          g_reload.store(true); // the previous swap is pending, retry
+        }
+      } catch (const std::exception &e) {
+        main_svc.messenger.notify("main", e.what());
+      }
+    }
+  }
+
+#if BEHAVIOR_PROFILING
+  Profiler::global().report(std::cout);
+#endif
 }
 
 
@@ -0,0 +1,37 @@
+#include "log.hpp"
+#include <iostream>
+
+std::ostream &write_log(std::ostream &out, const LogRecord &r) {
+  uint8_t next = 0;
+  for (const char *c = r.fmt->text; *c != '\0'; ++c) {
+    if (c[0] == '{' && c[1] == '}' && next < r.nargs) {
+      const auto &a = r.args[next++];
+      switch (a.type) {
+      case LogArg::Type::Double:
+        out << a.d;
+        break;
+      case LogArg::Type::Int:
+        out << a.i;
+        break;
+      case LogArg::Type::Str:
+        out << a.s;
+        break;
+      }
+      ++c;
+    } else {
+      out << *c;
+    }
+  }
+  return out;
+}
+
+std::ostream &console_stream() { return std::cout; }
+
+void console_write(const char *source, const char *msg, std::size_t len) {
+  std::cout << "[" << source << "] ";
+  std::cout.write(msg, static_cast<std::streamsize>(len)) << std::endl;
+}
+
+void console_write(const char *source, const LogRecord &record) {
+  write_log(std::cout << "[" << source << "] ", record) << std::endl;
+}
@@ -0,0 +1,169 @@
+#pragma once
+#include "executor.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+// The settings of a MissionPlanner evaluation
+struct PlannerOptions {
+  // The cost a tick adds to its candidate, from the tick's sense, its outcome and the simulated
+  // seconds since the previous tick. It must not be negative: the cost of a candidate only grows,
+  // which is what allows abandoning it once it exceeds the best. The default is the mission time.
+  using TickCost = double (*)(const SenseInfo &s, const Outcome &o, double dt);
+
+  TickSchedule schedule{std::chrono::milliseconds{10}, OverrunPolicy::Skip, false};
+  // candidates still running after the simulated time limit are abandoned
+  std::chrono::nanoseconds time_limit{std::chrono::seconds{600}};
+  TickCost tick_cost{[](const SenseInfo &, const Outcome &, double dt) { return dt; }};
+  // added to the cost of a candidate completing with Fail
+  double fail_cost{std::numeric_limits<double>::infinity()};
+  // abandon a candidate as soon as its cost exceeds the best successful candidate's
+  bool early_cutoff{true};
+};
+
+// The evaluation of one candidate
+struct PlanResult {
+  Outcome out;                         // the last outcome, Running when abandoned
+  std::chrono::nanoseconds duration{}; // the simulated time the candidate ran for
+  double cost{0};                      // the total cost, only a lower bound when abandoned
+  uint64_t ticks{0};
+  bool abandoned{false};               // cut off early or by the time limit
+};
+
+// Chooses a mission by evaluating candidate trees in simulation. Every candidate is built by its
+// factory and run from the same initial sense on its own SimClock, so a run takes as long as its
+// ticks instead of its simulated time, and the candidates are spread across a ThreadPool. A
+// candidate's cost accumulates tick by tick; once a candidate succeeded, every candidate whose cost
+// grows beyond it is abandoned at the tick it does.
+//
+//   MissionPlanner planner;
+//   std::vector<MissionPlanner::Factory> candidates;
+//   for (double goal : {2.0, 4.0, 8.0}) {
+//     candidates.push_back(
+//         [goal] { return std::make_unique<WalkThenStop>(WalkToPosition{goal}, Stop{}); });
+//   }
+//   auto results = planner.evaluate(candidates, sense);
+//   auto best = MissionPlanner::best(results);
+//
+// The factories are called on the pool's threads and the candidates tick in parallel: the
+// factories and the Services must be safe to use from several threads, e.g. a silenced messenger.
+// Which candidates are abandoned depends on the order they complete in, the best candidate does
+// not.
+class MissionPlanner {
+public:
+  using Factory = std::function<std::unique_ptr<BehaviorElement>()>;
+
+  static constexpr std::size_t NONE = SIZE_MAX;
+
+  explicit MissionPlanner(std::size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+      : m_pool(threads) {}
+
+  // Runs every candidate to completion, to its cutoff or to the time limit. The results are in the
+  // order of the factories.
+  std::vector<PlanResult> evaluate(const std::vector<Factory> &candidates, const SenseInfo &initial,
+                                   const PlannerOptions &options = {}, Services svc = quiet()) {
+    Job job{candidates, initial, options, svc, std::vector<PlanResult>(candidates.size()), {}, {}};
+    job.best.store(std::numeric_limits<double>::infinity(), std::memory_order_relaxed);
+
+    // a task per thread taking the next candidate until none is left, the candidates' run lengths
+    // differ too much for fixed ranges, and a task per candidate would overflow the queue
+    auto tasks = std::min(m_pool.size(), candidates.size());
+    ThreadPool::TaskGroup group;
+    for (std::size_t t = 1; t < tasks; ++t) {
+      m_pool.submit(group, &MissionPlanner::run_candidates, &job, t);
+    }
+    run_candidates(&job, 0);
+    m_pool.wait(group);
+    return std::move(job.results);
+  }
+
+  // The index of the successful candidate with the lowest cost, NONE when no candidate succeeded
+  static std::size_t best(const std::vector<PlanResult> &results) {
+    std::size_t best = NONE;
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      const auto &r = results[i];
+      if (!r.abandoned && r.out.value == Outcome::Return::Success &&
+          (best == NONE || r.cost < results[best].cost)) {
+        best = i;
+      }
+    }
+    return best;
+  }
+
+private:
+  struct Job {
+    const std::vector<Factory> &candidates;
+    SenseInfo initial;
+    PlannerOptions options;
+    Services svc;
+    std::vector<PlanResult> results;
+    std::atomic<double> best;      // the cost of the best successful candidate so far
+    std::atomic<std::size_t> next; // the next candidate to run
+  };
+
+  static Services quiet() {
+    Services svc;
+    svc.messenger.threshold = LogLevel::Off;
+    return svc;
+  }
+
+  static void run_candidates(void *ctx, std::size_t) {
+    auto &job = *static_cast<Job *>(ctx);
+    for (auto i = job.next.fetch_add(1, std::memory_order_relaxed); i < job.candidates.size();
+         i = job.next.fetch_add(1, std::memory_order_relaxed)) {
+      run_candidate(job, i);
+    }
+  }
+
+  static void run_candidate(Job &job, std::size_t i) {
+    const auto &options = job.options;
+    auto &result = job.results[i];
+
+    auto tree = job.candidates[i]();
+    SimClock clock;
+    SimulatedIo io(job.initial);
+    ExecutorRun<SimulatedIo> run(*tree, job.svc, io, options.schedule.reactive);
+    PeriodicScheduler<SimClock> scheduler(options.schedule, clock);
+    auto start = clock.now();
+    auto now = start;
+    auto prev = now;
+
+    run.start();
+    for (;;) {
+      result.out = run.step(now);
+      ++result.ticks;
+      std::chrono::duration<double> dt = now - prev;
+      result.cost += options.tick_cost(io.current(), result.out, dt.count());
+      if (result.out.value != Outcome::Return::Running) {
+        break;
+      }
+      if ((options.early_cutoff && result.cost > job.best.load(std::memory_order_relaxed)) ||
+          now - start >= options.time_limit) {
+        result.abandoned = true;
+        break;
+      }
+      prev = now;
+      now = scheduler.wait_next();
+    }
+    run.stop();
+    result.duration = now - start;
+
+    if (result.out.value == Outcome::Return::Fail) {
+      result.cost += options.fail_cost;
+    } else if (result.out.value == Outcome::Return::Success) {
+      // publish a new best
+      auto best = job.best.load(std::memory_order_relaxed);
+      while (result.cost < best &&
+             !job.best.compare_exchange_weak(best, result.cost, std::memory_order_relaxed)) {
+      }
+    }
+  }
+
+  ThreadPool m_pool;
+};
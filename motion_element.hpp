@@ -0,0 +1,135 @@
+#pragma once
+#include "behavior_element.hpp"
+#include <chrono>
+
+// The MotionElements of a library are best instantiated once, in one of the library's sources, and
+// declared extern template next to their definition, see motion_elements.hpp. The translation units
+// using them then no longer instantiate the CRTP base and its compile-time checks.
+
+// A MotionElement is a class of BehaviorElements that actuate the robot. This is different
+// than a SequenceElement since a SequenceElement is container operating on elements forming a logical
+// expression.
+//
+// The MotionElement implements Continuously Recurring Template Pattern in order to take advantage of
+// static-polymorphism. 
+//
+template <class Derived> class MotionElement : public BehaviorElement {
+public:
+  // Required Name Trait
+  static constexpr char const *const NAME =
+      nullptr; // Derived must specify name
+
+  // Required Reaction Definition
+  static constexpr ReactionDef KNEE_JERK_REACTION = ReactionDef_REQUIRED;
+  static constexpr ReactionDef FLINCH_REACTION = ReactionDef_REQUIRED;
+
+  // Optional Reaction Definition, further ReactionIds enabled while the element executes
+  static constexpr ReactionSet ADDITIONAL_REACTIONS = 0;
+
+  // Optional Sense Dependency Trait, the SenseFields the tick reads. Elements depending on less than
+  // every field can be skipped by reactive executors while their fields do not change.
+  static constexpr uint32_t SENSE_DEPENDENCIES = SenseField_ALL;
+
+  // Overridable static methods (in place of virtual methods)
+  static ElementMeta motion_element_initialize(Derived &) {
+    return ElementMeta{Derived::NAME};
+  }
+  static void motion_element_finalize(Derived &) {}
+  static void motion_element_data_initialize(Derived &, const SenseInfo &) {
+  }
+  // the time the element must be ticked by even if its sense dependencies did not change
+  static std::chrono::steady_clock::time_point motion_element_next_wake(const Derived &) {
+    return std::chrono::steady_clock::time_point::max();
+  }
+
+  ElementMeta initialize(const Services &svc) final { return initialize_element(svc, false); }
+
+  // Initializes the element for a parent composite applying the element's reactions on its behalf,
+  // e.g. a StaticSequence handing its reactions over from one child to the next
+  ElementMeta initialize_delegated(const Services &svc) { return initialize_element(svc, true); }
+
+  // The reactions enabled while the element executes, computed at compile time from the traits
+  static constexpr ReactionSet reactions() {
+    return (Derived::KNEE_JERK_REACTION == ReactionDef_ENABLED ? reaction_bit(ReactionId_KNEE_JERK)
+                                                                : 0) |
+           (Derived::FLINCH_REACTION == ReactionDef_ENABLED ? reaction_bit(ReactionId_FLINCH) : 0) |
+           Derived::ADDITIONAL_REACTIONS;
+  }
+
+  Outcome tick(const SenseInfo &sense) final {
+    if (m_first_tick) {
+      m_first_tick = false;
+      Derived::motion_element_data_initialize(derived(), sense);
+    }
+
+    return Derived::motion_element_tick(derived(), sense);
+  }
+
+  WakeCondition wake_condition() const final {
+    if (m_first_tick) {
+      // the data initialization is pending
+      return WakeCondition{};
+    }
+    return WakeCondition{Derived::SENSE_DEPENDENCIES,
+                         Derived::motion_element_next_wake(static_cast<const Derived &>(*this))};
+  }
+
+  void finalize() final {
+    // perform the derived finalization if it is supported
+    Derived::motion_element_finalize(derived());
+
+    // unmute reactions
+    if (!m_delegated) {
+      m_services->reaction_svc.release(reactions());
+    }
+  }
+
+  Footprint footprint() const final { return Footprint{sizeof(Derived), 1, 0}; }
+
+protected:
+  const Services::MessengerSvc &messenger() const { return m_services->messenger; };
+  const SenseHistory *history() const { return m_services->history; }
+
+private:
+  ElementMeta initialize_element(const Services &svc, bool delegated) {
+    //////////////////////////////////////////
+    // Compile Time Checks
+    //////////////////////////////////////////
+
+    // check that name has been specified
+    static_assert(Derived::NAME != nullptr,
+                  "The Derived BehaviorElement must specify the NAME trait");
+
+    // compile-time check ensuring the derived specified all of the reaction
+    // traits
+    static_assert(
+        Derived::FLINCH_REACTION != ReactionDef_REQUIRED,
+        "FLINCH_REACTION trait must be specified in the derived class");
+    static_assert(
+        Derived::KNEE_JERK_REACTION != ReactionDef_REQUIRED,
+        "KNEE_JERK_REACTION trait must be specified in the derived class");
+
+    //////////////////////////////////////////
+    // Run Time Implementation
+    //////////////////////////////////////////
+
+    // reset internal variables for continued reuse of the object
+    m_first_tick = true;
+    m_services = &svc;
+    m_delegated = delegated;
+
+    // specify the muted reactions for the duration of the container and
+    // sub-containers.
+    if (!m_delegated) {
+      m_services->reaction_svc.activate(reactions());
+    }
+
+    // call the statically overridable initialization
+    return Derived::motion_element_initialize(derived());
+  }
+
+  Derived &derived() { return static_cast<Derived &>(*this); }
+  const Services *m_services{&Services::none()};
+  bool m_first_tick{true}; // for data initialization during the first tick()
+  bool m_delegated{false}; // the parent applies the reactions
+};
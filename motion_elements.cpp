@@ -0,0 +1,5 @@
+#include "motion_elements.hpp"
+
+// The one instantiation of the MotionElement base of the elements in motion_elements.hpp
+template class MotionElement<Stop>;
+template class MotionElement<WalkToPosition>;
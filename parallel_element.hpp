@@ -0,0 +1,177 @@
+#pragma once
+#include "behavior_element.hpp"
+#include "child_list.hpp"
+#include "profiling.hpp"
+#include "thread_pool.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <vector>
+
+// A ParallelElement is a container of BehaviorElements that ticks all of its children on every
+// tick, e.g. perception checks alongside the motion that depends on them. The children's ticks run
+// concurrently on a shared work-stealing ThreadPool and are joined before the tick returns.
+//
+// The element succeeds once success_threshold children succeeded and fails once failure_threshold
+// children failed; by default every child must succeed and the first failure fails the element.
+// The outcomes are merged in child order after the join, so the result does not depend on
+// scheduling: the actuation command is taken from the lowest indexed child ticked during the tick.
+//
+// initialize, finalize and the lifecycle notifications run on the ticking thread in child order,
+// only the children's ticks run concurrently. Children ticking concurrently share the Services, so
+// the messenger backend must accept concurrent producers.
+class ParallelElement : public BehaviorElement {
+public:
+  using Elements = std::pmr::vector<std::reference_wrapper<BehaviorElement>>;
+
+  ParallelElement(const Elements &el, ThreadPool &pool)
+      : ParallelElement(el, pool, el.size(), 1) {}
+  ParallelElement(const Elements &el, ThreadPool &pool, std::size_t success_threshold,
+                  std::size_t failure_threshold,
+                  std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+      : m_pool(pool), m_elements(el.data(), el.size(), mr), m_children(el.size(), mr),
+        m_success_threshold(success_threshold), m_failure_threshold(failure_threshold) {}
+
+  ElementMeta initialize(const Services &svc) override {
+    m_svcs = &svc;
+    for (auto &c : m_children) {
+      c.state = State::Idle;
+    }
+    m_successes = 0;
+    m_failures = 0;
+    return ElementMeta{"Parallel"};
+  }
+
+  Outcome tick(const SenseInfo &s) override {
+    Outcome o;
+    o.value = Outcome::Return::Running;
+
+    // initialize the new children and notify in order
+    for (std::size_t i = 0; i < m_children.size(); ++i) {
+      auto &c = m_children[i];
+      if (c.state == State::Idle) {
+        c.meta = m_elements[i].get().initialize(*m_svcs);
+        m_svcs->lifecycle.emit(LifecycleKind_INITIALIZE, &m_elements[i].get(), c.meta.name);
+        c.state = State::Active;
+      }
+      if (c.state == State::Active) {
+        m_svcs->lifecycle.emit(LifecycleKind_TICK, &m_elements[i].get(), c.meta.name);
+      }
+    }
+
+    // fork: every active child but the first is queued, the first runs on this thread
+    m_sense = &s;
+    ThreadPool::TaskGroup group;
+    std::size_t first = m_children.size();
+    for (std::size_t i = 0; i < m_children.size(); ++i) {
+      if (m_children[i].state != State::Active) {
+        continue;
+      }
+      if (first == m_children.size()) {
+        first = i;
+      } else {
+        m_pool.submit(group, &ParallelElement::tick_child, this, i);
+      }
+    }
+    if (first < m_children.size()) {
+      tick_child(this, first);
+    }
+    // join
+    m_pool.wait(group);
+
+    // merge in child order
+    bool has_actuate = false;
+    for (std::size_t i = 0; i < m_children.size(); ++i) {
+      auto &c = m_children[i];
+      if (c.state != State::Active) {
+        continue;
+      }
+      if (!has_actuate) {
+        o.actuate = c.outcome.actuate;
+        has_actuate = true;
+      }
+      if (c.outcome.value != Outcome::Return::Running) {
+        m_elements[i].get().finalize();
+        m_svcs->lifecycle.emit(LifecycleKind_FINALIZE, &m_elements[i].get(), c.meta.name,
+                              c.outcome.value);
+        c.state = State::Done;
+        if (c.outcome.value == Outcome::Return::Success) {
+          ++m_successes;
+        } else {
+          ++m_failures;
+        }
+      }
+    }
+
+    if (m_failures >= m_failure_threshold || m_children.empty()) {
+      o.value = Outcome::Return::Fail;
+    } else if (m_successes >= m_success_threshold) {
+      o.value = Outcome::Return::Success;
+    } else if (m_successes + m_failures == m_children.size()) {
+      // every child is done, but the success threshold cannot be met anymore
+      o.value = Outcome::Return::Fail;
+    }
+
+    if (o.value != Outcome::Return::Running) {
+      finalize();
+    }
+    return o;
+  }
+
+  Footprint footprint() const override {
+    return Footprint{sizeof(*this) + m_elements.heap_bytes() + m_children.capacity() * sizeof(Child),
+                     1, 0} +
+           m_elements.children_footprint();
+  }
+
+  WakeCondition wake_condition() const override {
+    WakeCondition wake{0, WakeCondition{}.deadline};
+    for (std::size_t i = 0; i < m_children.size(); ++i) {
+      if (m_children[i].state == State::Idle) {
+        return WakeCondition{};
+      }
+      if (m_children[i].state == State::Active) {
+        wake = wake | m_elements[i].get().wake_condition();
+      }
+    }
+    return wake;
+  }
+
+  void finalize() override {
+    // finalize the children still running when the parallel completes
+    for (std::size_t i = 0; i < m_children.size(); ++i) {
+      auto &c = m_children[i];
+      if (c.state == State::Active) {
+        m_elements[i].get().finalize();
+        m_svcs->lifecycle.emit(LifecycleKind_FINALIZE, &m_elements[i].get(), c.meta.name);
+        c.state = State::Done;
+      }
+    }
+  }
+
+private:
+  enum class State : uint8_t { Idle, Active, Done };
+
+  // aligned so the concurrent writes of the outcomes do not share cache lines
+  struct alignas(64) Child {
+    State state{State::Idle};
+    ElementMeta meta{};
+    Outcome outcome{};
+  };
+
+  static void tick_child(void *ctx, std::size_t i) {
+    auto &me = *static_cast<ParallelElement *>(ctx);
+    ProfileScope profile(me.m_children[i].meta.name);
+    me.m_children[i].outcome = me.m_elements[i].get().tick(*me.m_sense);
+  }
+
+  ThreadPool &m_pool;
+  const Services *m_svcs{&Services::none()};
+  ChildList m_elements;
+  std::pmr::vector<Child> m_children;
+  const SenseInfo *m_sense{nullptr};
+  std::size_t m_successes{0};
+  std::size_t m_failures{0};
+  std::size_t m_success_threshold;
+  std::size_t m_failure_threshold;
+};
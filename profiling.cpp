@@ -0,0 +1,23 @@
+#include "profiling.hpp"
+#include <cstdio>
+#include <ostream>
+
+namespace {
+unsigned long long ull(uint64_t v) { return static_cast<unsigned long long>(v); }
+} // namespace
+
+void Profiler::report(std::ostream &out) const {
+  out << "element                  ticks      p50(ns)    p99(ns)    max(ns)    overruns\n";
+  for (auto &e : m_entries) {
+    auto *name = e.name.load(std::memory_order_acquire);
+    if (name == nullptr) {
+      break;
+    }
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-20s %10llu %10llu %10llu %10llu %10llu\n", name,
+                  ull(e.ticks.count()), ull(e.ticks.percentile(0.5)),
+                  ull(e.ticks.percentile(0.99)), ull(e.ticks.max()),
+                  ull(e.overruns.load(std::memory_order_relaxed)));
+    out << line;
+  }
+}
@@ -0,0 +1,177 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iosfwd>
+
+// Opt-in tick instrumentation. Build with BEHAVIOR_PROFILING=1 (cmake -DDFS_PROFILING=ON) and the
+// composites and executors record the duration of every element tick into a per-element latency
+// histogram of the global Profiler. Without it a ProfileScope is an empty object and the
+// instrumentation compiles to nothing.
+#ifndef BEHAVIOR_PROFILING
+#define BEHAVIOR_PROFILING 0
+#endif
+
+// Lock-free latency histogram with HDR-style log-linear buckets: every power of two is split into
+// 16 linear sub-buckets, bounding the error of a reported value to 1/16th of it. Recording is a
+// handful of relaxed atomic increments, so any number of threads may record concurrently.
+class LatencyHistogram {
+public:
+  static constexpr unsigned SUB_BITS = 4;
+  static constexpr unsigned SUB_BUCKETS = 1u << SUB_BITS;
+  static constexpr std::size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+  void record(uint64_t ns) {
+    m_buckets[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    auto max = m_max.load(std::memory_order_relaxed);
+    while (ns > max && !m_max.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+  }
+
+  uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+  uint64_t max() const { return m_max.load(std::memory_order_relaxed); }
+
+  // The value below which the given fraction, [0, 1], of the recorded values fall
+  uint64_t percentile(double p) const {
+    auto total = count();
+    if (total == 0) {
+      return 0;
+    }
+    auto rank = static_cast<uint64_t>(p * static_cast<double>(total - 1)) + 1;
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKETS; ++i) {
+      seen += m_buckets[i].load(std::memory_order_relaxed);
+      if (seen >= rank) {
+        return std::min(upper_bound(i), max());
+      }
+    }
+    return max();
+  }
+
+private:
+  static unsigned log2(uint64_t v) {
+#if defined(__GNUC__)
+    return 63u - static_cast<unsigned>(__builtin_clzll(v));
+#else
+    unsigned e = 0;
+    while (v >>= 1) {
+      ++e;
+    }
+    return e;
+#endif
+  }
+
+  static std::size_t bucket(uint64_t v) {
+    if (v < SUB_BUCKETS) {
+      return static_cast<std::size_t>(v);
+    }
+    auto e = log2(v);
+    auto sub = (v >> (e - SUB_BITS)) & (SUB_BUCKETS - 1);
+    return (e - SUB_BITS + 1) * SUB_BUCKETS + sub;
+  }
+
+  static uint64_t upper_bound(std::size_t i) {
+    if (i < SUB_BUCKETS) {
+      return i;
+    }
+    auto e = static_cast<unsigned>(i / SUB_BUCKETS) + SUB_BITS - 1;
+    auto sub = i % SUB_BUCKETS;
+    auto width = uint64_t{1} << (e - SUB_BITS);
+    return ((SUB_BUCKETS + sub) << (e - SUB_BITS)) + width - 1;
+  }
+
+  std::array<std::atomic<uint64_t>, BUCKETS> m_buckets{};
+  std::atomic<uint64_t> m_count{0};
+  std::atomic<uint64_t> m_max{0};
+};
+
+// Per-element tick statistics, keyed by ElementMeta::name. Entries are claimed lock-free on the
+// first tick of an element and never released; the table holds MAX_ELEMENTS distinct names, ticks of
+// further names are not recorded.
+class Profiler {
+public:
+  static constexpr std::size_t MAX_ELEMENTS = 64;
+
+  struct Entry {
+    std::atomic<const char *> name{nullptr};
+    LatencyHistogram ticks;
+    std::atomic<uint64_t> overruns{0}; // ticks longer than the deadline
+  };
+
+  static Profiler &global() {
+    static Profiler profiler;
+    return profiler;
+  }
+
+  // Ticks longer than the deadline are counted as overruns, executors set it to their period.
+  void set_deadline(std::chrono::nanoseconds deadline) {
+    m_deadline_ns.store(static_cast<uint64_t>(deadline.count()), std::memory_order_relaxed);
+  }
+
+  void record_tick(const char *name, uint64_t ns) {
+    auto *e = entry(name);
+    if (e == nullptr) {
+      return;
+    }
+    e->ticks.record(ns);
+    if (ns > m_deadline_ns.load(std::memory_order_relaxed)) {
+      e->overruns.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  // The entry of the element, claiming a free one for a new name. Null when the table is full.
+  Entry *entry(const char *name) {
+    if (name == nullptr) {
+      return nullptr;
+    }
+    for (auto &e : m_entries) {
+      auto *cur = e.name.load(std::memory_order_acquire);
+      if (cur == nullptr) {
+        if (e.name.compare_exchange_strong(cur, name, std::memory_order_acq_rel)) {
+          return &e;
+        }
+        // lost the race for the slot, cur holds the winner's name
+      }
+      if (cur == name || std::strcmp(cur, name) == 0) {
+        return &e;
+      }
+    }
+    return nullptr;
+  }
+
+  // Writes the p50/p99/max tick durations per element. Defined in profiling.cpp.
+  void report(std::ostream &out) const;
+
+private:
+
+  std::array<Entry, MAX_ELEMENTS> m_entries{};
+  std::atomic<uint64_t> m_deadline_ns{UINT64_MAX};
+};
+
+#if BEHAVIOR_PROFILING
+// Records the duration of the enclosing scope as a tick of the named element
+class ProfileScope {
+public:
+  explicit ProfileScope(const char *name)
+      : m_name(name), m_start(std::chrono::steady_clock::now()) {}
+  ~ProfileScope() {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - m_start)
+                  .count();
+    Profiler::global().record_tick(m_name, static_cast<uint64_t>(ns));
+  }
+
+private:
+  const char *m_name;
+  std::chrono::steady_clock::time_point m_start;
+};
+#else
+class ProfileScope {
+public:
+  explicit ProfileScope(const char *) {}
+};
+#endif
@@ -0,0 +1,88 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+// A set of reactions, one bit per ReactionId
+using ReactionSet = uint64_t;
+
+// The shared state between the behavior executor, muting and unmuting reactions, and the reflex
+// layer querying them from its own high priority thread.
+//
+// Every reaction has a reference count so nested elements can request the same reaction without
+// releasing it for each other: a reaction is active as long as any element holds it. The counts are
+// bytes packed eight to an atomic word. Changing up to eight reactions of a word is one atomic
+// fetch_add of the per-byte deltas, which cannot carry between bytes as long as a count stays in
+// [0, 255]. Neither side takes a lock, so the reflex thread never waits on the behavior thread, and
+// reading the active set is wait-free.
+class ReactionState {
+public:
+  static constexpr std::size_t REACTIONS = 64;
+  static constexpr std::size_t PER_WORD = 8;
+  static constexpr std::size_t WORDS = REACTIONS / PER_WORD;
+  static constexpr unsigned MAX_COUNT = 255;
+
+  // Releases one reference of each reaction in released and adds one to each in activated
+  void apply(ReactionSet released, ReactionSet activated) {
+    for (std::size_t w = 0; w < WORDS; ++w) {
+      auto rel = byte_of(released, w);
+      auto act = byte_of(activated, w);
+      if ((rel | act) == 0) {
+        continue;
+      }
+      // per-byte +1/-1 computed in modular arithmetic, exact as long as no count leaves [0, 255]
+      auto prev = m_counts[w].fetch_add(spread(act) - spread(rel), std::memory_order_acq_rel);
+      assert((nonzero(prev) & rel) == rel && "a reaction was released more often than activated");
+      assert((saturated(prev) & act) == 0 && "too many nested activations of a reaction");
+      static_cast<void>(prev);
+    }
+  }
+
+  // The reactions held by at least one element. Wait-free, reads each word once.
+  ReactionSet active() const {
+    ReactionSet set = 0;
+    for (std::size_t w = 0; w < WORDS; ++w) {
+      set |= ReactionSet{nonzero(m_counts[w].load(std::memory_order_acquire))} << (w * PER_WORD);
+    }
+    return set;
+  }
+
+  // True when the reaction is held by at least one element. Wait-free, a single load.
+  bool is_active(unsigned reaction) const { return count(reaction) > 0; }
+
+  // The number of elements holding the reaction
+  unsigned count(unsigned reaction) const {
+    auto word = m_counts[reaction / PER_WORD].load(std::memory_order_acquire);
+    return static_cast<unsigned>((word >> (reaction % PER_WORD * 8)) & 0xFF);
+  }
+
+private:
+  static uint8_t byte_of(ReactionSet set, std::size_t w) {
+    return static_cast<uint8_t>(set >> (w * PER_WORD));
+  }
+
+  // Moves bit i of the byte to the lowest bit of byte i of the word
+  static uint64_t spread(uint8_t bits) {
+    uint64_t word = 0;
+    for (unsigned i = 0; i < PER_WORD; ++i) {
+      word |= uint64_t{(bits >> i) & 1u} << (i * 8);
+    }
+    return word;
+  }
+
+  // Bit i is set when byte i of the word is not zero
+  static uint8_t nonzero(uint64_t word) {
+    word |= word >> 4;
+    word |= word >> 2;
+    word |= word >> 1;
+    word &= 0x0101010101010101ull;
+    return static_cast<uint8_t>((word * 0x0102040810204080ull) >> 56);
+  }
+
+  // Bit i is set when byte i of the word is at MAX_COUNT
+  static uint8_t saturated(uint64_t word) { return static_cast<uint8_t>(~nonzero(~word)); }
+
+  std::array<std::atomic<uint64_t>, WORDS> m_counts{};
+};
@@ -0,0 +1,125 @@
+#include "reaction_state.hpp"
+#include "types.hpp"
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// Checks the reference counts of ReactionState: nested holders keep a reaction active until the
+// last one releases it, the byte-packed counts never carry into a neighbouring reaction, up to the
+// largest count, and concurrent holders on several threads leave every count at zero.
+
+namespace {
+
+int failed = 0;
+
+void check(bool ok, const char *what) {
+  if (!ok) {
+    std::printf("FAILED: %s\n", what);
+    ++failed;
+  }
+}
+
+void test_nesting() {
+  ReactionState state;
+  auto flinch = reaction_bit(ReactionId_FLINCH);
+  state.apply(0, flinch);
+  state.apply(0, flinch);
+  check(state.count(ReactionId_FLINCH) == 2, "two holders count two");
+  state.apply(flinch, 0);
+  check(state.is_active(ReactionId_FLINCH), "the reaction stays active while a holder is left");
+  state.apply(flinch, 0);
+  check(!state.is_active(ReactionId_FLINCH), "the last release deactivates the reaction");
+  check(state.active() == 0, "nothing is active after the releases");
+}
+
+void test_transition() {
+  ReactionState state;
+  auto flinch = reaction_bit(ReactionId_FLINCH);
+  auto knee_jerk = reaction_bit(ReactionId_KNEE_JERK);
+  state.apply(0, flinch);
+  state.apply(flinch, knee_jerk);
+  check(state.active() == knee_jerk, "a transition releases and activates in one update");
+  state.apply(knee_jerk, 0);
+  check(state.active() == 0, "the transition's reaction is released");
+}
+
+void test_saturation() {
+  ReactionState state;
+  // the reactions of every byte of the first word, and one of the last word
+  for (unsigned r = 0; r < ReactionState::PER_WORD; ++r) {
+    for (unsigned i = 0; i < ReactionState::MAX_COUNT; ++i) {
+      state.apply(0, ReactionSet{1} << r);
+    }
+  }
+  state.apply(0, ReactionSet{1} << 63);
+  bool counts = true;
+  for (unsigned r = 0; r < ReactionState::PER_WORD; ++r) {
+    counts &= state.count(r) == ReactionState::MAX_COUNT;
+  }
+  check(counts, "every reaction of a word counts up to the largest count");
+  check(state.count(ReactionState::PER_WORD) == 0, "a full word does not carry into the next");
+  check(state.count(63) == 1, "the last reaction counts");
+
+  for (unsigned i = 0; i < ReactionState::MAX_COUNT; ++i) {
+    state.apply(0xFF, 0);
+  }
+  check(state.active() == ReactionSet{1} << 63, "releasing a full word leaves the others alone");
+  state.apply(ReactionSet{1} << 63, 0);
+  check(state.active() == 0, "nothing is active after the releases");
+}
+
+void test_svc() {
+  ReactionState state;
+  Services svc;
+  auto flinch = reaction_bit(ReactionId_FLINCH);
+  svc.reaction_svc.activate(flinch);
+  check(state.active() == 0, "a service without state changes nothing");
+  svc.reaction_svc.state = &state;
+  svc.reaction_svc.activate(flinch);
+  svc.reaction_svc.activate(flinch);
+  svc.reaction_svc.release(flinch);
+  check(state.count(ReactionId_FLINCH) == 1, "the service applies the nested holds");
+  svc.reaction_svc.release(flinch);
+  check(state.active() == 0, "the service releases the last hold");
+}
+
+void test_concurrent() {
+  constexpr int THREADS = 8;
+  constexpr int ROUNDS = 20000;
+  ReactionState state;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; ++t) {
+    threads.emplace_back([&state, t] {
+      // every thread holds a reaction shared by all and one of its own, nested
+      auto shared = reaction_bit(ReactionId_FLINCH);
+      auto own = ReactionSet{1} << (8 + t);
+      for (int i = 0; i < ROUNDS; ++i) {
+        state.apply(0, shared | own);
+        state.apply(0, own);
+        state.apply(own, 0);
+        state.apply(shared | own, 0);
+      }
+    });
+  }
+  bool bounded = true;
+  for (int i = 0; i < ROUNDS; ++i) {
+    bounded &= state.count(ReactionId_FLINCH) <= THREADS;
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  check(bounded, "the shared reaction never counts more holders than there are");
+  check(state.active() == 0, "the concurrent holders leave every count at zero");
+}
+
+} // namespace
+
+int main() {
+  test_nesting();
+  test_transition();
+  test_saturation();
+  test_svc();
+  test_concurrent();
+  std::printf("%d checks failed\n", failed);
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <vector>
+#if defined(__GLIBC__)
+#include <alloca.h>
+#endif
+
+// Real-time configuration of the thread running the executor, so the tick thread is not preempted
+// by the mapping and planning threads, not migrated between cores, and does not page fault.
+//
+//   RealtimeOptions rt;
+//   rt.priority = 80;
+//   rt.cpus = {3}; // an isolated core, e.g. isolcpus=3
+//   rt.lock_memory = true;
+//   auto result = std::async(std::launch::async, [&] {
+//     auto status = apply_realtime(rt);
+//     return Executor::run(root, schedule, svc);
+//   });
+//
+// Raising the priority and locking memory need privileges (CAP_SYS_NICE, CAP_IPC_LOCK or matching
+// rlimits); a setting that cannot be applied is reported in the RealtimeStatus and the thread runs
+// on with the remaining settings.
+struct RealtimeOptions {
+  int priority{0};             // SCHED_FIFO priority, 1 to 99. 0 keeps the default scheduler
+  std::vector<int> cpus{};     // the CPUs the thread may run on, empty keeps the inherited set
+  bool lock_memory{false};     // lock the current and future pages of the process into RAM
+  std::size_t prefault_stack{0}; // bytes of stack to touch up front, so ticks do not fault it in
+};
+
+// The errno of each setting apply_realtime() could not apply, 0 when applied or not requested
+struct RealtimeStatus {
+  int scheduler{0};
+  int affinity{0};
+  int memory_lock{0};
+
+  bool ok() const { return scheduler == 0 && affinity == 0 && memory_lock == 0; }
+};
+
+namespace realtime_detail {
+constexpr std::size_t PAGE = 4096;
+
+// Touches the pages of size bytes of stack below the caller's frame
+[[gnu::noinline]] inline void prefault_stack(std::size_t size) {
+#if defined(__GLIBC__)
+  auto *stack = static_cast<volatile char *>(alloca(size));
+  for (std::size_t i = 0; i < size; i += PAGE) {
+    stack[i] = 0;
+  }
+#else
+  static_cast<void>(size);
+#endif
+}
+} // namespace realtime_detail
+
+// Applies the options to the calling thread, and memory locking to the whole process
+inline RealtimeStatus apply_realtime(const RealtimeOptions &options) {
+  RealtimeStatus status;
+
+  if (options.lock_memory && ::mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    status.memory_lock = errno;
+  }
+
+#if defined(__linux__)
+  if (!options.cpus.empty()) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : options.cpus) {
+      CPU_SET(cpu, &set);
+    }
+    status.affinity = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+  }
+#else
+  if (!options.cpus.empty()) {
+    status.affinity = ENOTSUP;
+  }
+#endif
+
+  if (options.priority > 0) {
+    sched_param param{};
+    param.sched_priority = options.priority;
+    status.scheduler = ::pthread_setschedparam(::pthread_self(), SCHED_FIFO, &param);
+  }
+
+  // after locking, so the prefaulted pages stay resident
+  if (options.prefault_stack > 0) {
+    realtime_detail::prefault_stack(options.prefault_stack);
+  }
+  return status;
+}
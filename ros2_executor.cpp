@@ -0,0 +1,6 @@
+// Compiles the ROS 2 adapter, which is header only, so a change to the executor's APIs fails the
+// build instead of the packages including the header. Built by the dfs_ros2 target.
+#if !__has_include(<rclcpp/rclcpp.hpp>)
+#error "the ROS 2 adapter requires rclcpp"
+#endif
+#include "ros2_executor.hpp"
@@ -0,0 +1,197 @@
+#pragma once
+
+// ROS 2 integration of the executor. Only available when building against rclcpp, e.g. in an
+// ament package depending on rclcpp, nav_msgs and geometry_msgs.
+#if __has_include(<rclcpp/rclcpp.hpp>)
+#include "async_messenger.hpp"
+#include "executor.hpp"
+#include "sense_channel.hpp"
+#include <chrono>
+#include <functional>
+#include <geometry_msgs/msg/twist.hpp>
+#include <memory>
+#include <nav_msgs/msg/odometry.hpp>
+#include <ostream>
+#include <rclcpp/rclcpp.hpp>
+#include <std_msgs/msg/bool.hpp>
+#include <streambuf>
+#include <string>
+
+// A streambuf writing every line to a ROS logger, the output of an AsyncMessenger bridging the
+// messenger to rosout from the messenger's consumer thread.
+class RosoutStreambuf : public std::streambuf {
+public:
+  explicit RosoutStreambuf(rclcpp::Logger logger) : m_logger(std::move(logger)) {}
+
+protected:
+  int overflow(int c) override {
+    if (c != traits_type::eof()) {
+      char ch = static_cast<char>(c);
+      xsputn(&ch, 1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  std::streamsize xsputn(const char *s, std::streamsize n) override {
+    for (std::streamsize i = 0; i < n; ++i) {
+      if (s[i] == '\n') {
+        RCLCPP_INFO(m_logger, "%s", m_line.c_str());
+        m_line.clear();
+      } else {
+        m_line.push_back(s[i]);
+      }
+    }
+    return n;
+  }
+
+private:
+  rclcpp::Logger m_logger;
+  std::string m_line;
+};
+
+struct Ros2ExecutorOptions {
+  std::string odometry_topic{"odom"};         // nav_msgs/Odometry, x and linear velocity
+  std::string flinching_topic{"flinching"};   // std_msgs/Bool
+  std::string knee_jerking_topic{"knee_jerking"}; // std_msgs/Bool
+  std::string cmd_topic{"cmd_vel"};           // geometry_msgs/Twist, linear velocity
+  std::chrono::nanoseconds period{std::chrono::milliseconds{1}};
+  bool reactive{false};
+  // samples older than max_age when ticked are counted as stale, see ChannelIo
+  std::chrono::nanoseconds max_age{std::chrono::milliseconds{10}};
+};
+
+// Runs an element inside a ROS 2 node: the ticks are the callbacks of a timer, the sense is
+// assembled from the sensor topics and every tick's command is published to the cmd topic.
+//
+//   auto node = std::make_shared<rclcpp::Node>(
+//       "behavior", rclcpp::NodeOptions().use_intra_process_comms(true));
+//   Ros2Executor executor(*node, mission, svc, {}, [](const Outcome &) { rclcpp::shutdown(); });
+//   rclcpp::executors::MultiThreadedExecutor spinner;
+//   spinner.add_node(node);
+//   spinner.spin();
+//
+// The sensor subscriptions and the timer are in separate callback groups, so a multi-threaded ROS
+// executor runs them concurrently. The subscriptions take the messages as shared pointers to const,
+// which intra-process transport delivers without copying or serializing them, and write each
+// sample once into a SenseChannel; the tick reads the latest sample in place. The commands are
+// published as loaned messages when the middleware supports loans, otherwise as unique pointers,
+// again without a copy for intra-process subscribers. The messenger goes through an AsyncMessenger
+// to rosout, off of the tick callback.
+//
+// The sense timestamps are the steady clock at the reception of the odometry, the time base of the
+// elements. Stop the spinning before destroying the executor.
+class Ros2Executor {
+public:
+  using Done = std::function<void(const Outcome &)>;
+
+  Ros2Executor(rclcpp::Node &node, BehaviorElement &element, Services svc = {},
+               Ros2ExecutorOptions options = {}, Done done = {})
+      : m_options(std::move(options)), m_done(std::move(done)), m_rosout(node.get_logger()),
+        m_rosout_stream(&m_rosout), m_messenger(m_rosout_stream),
+        m_io(m_channel, m_cmd, m_options.max_age),
+        m_run(element, with_backend(svc, &m_messenger), m_io, m_options.reactive) {
+    m_sense_group = node.create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+    m_tick_group = node.create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+
+    rclcpp::SubscriptionOptions sub_options;
+    sub_options.callback_group = m_sense_group;
+    auto qos = rclcpp::SensorDataQoS();
+
+    m_odometry = node.create_subscription<nav_msgs::msg::Odometry>(
+        m_options.odometry_topic, qos,
+        [this](std::shared_ptr<const nav_msgs::msg::Odometry> msg) {
+          m_sense.measured_x = msg->pose.pose.position.x;
+          m_sense.measured_velocity = msg->twist.twist.linear.x;
+          m_sense.ts = std::chrono::steady_clock::now();
+          m_channel.publish(m_sense);
+        },
+        sub_options);
+    // the flags are published with the next odometry
+    m_flinching = node.create_subscription<std_msgs::msg::Bool>(
+        m_options.flinching_topic, qos,
+        [this](std::shared_ptr<const std_msgs::msg::Bool> msg) { m_sense.is_flinching = msg->data; },
+        sub_options);
+    m_knee_jerking = node.create_subscription<std_msgs::msg::Bool>(
+        m_options.knee_jerking_topic, qos,
+        [this](std::shared_ptr<const std_msgs::msg::Bool> msg) {
+          m_sense.is_knee_jerking = msg->data;
+        },
+        sub_options);
+
+    m_cmd.publisher = node.create_publisher<geometry_msgs::msg::Twist>(m_options.cmd_topic, 10);
+
+    m_timer = node.create_wall_timer(m_options.period, [this] { on_tick(); }, m_tick_group);
+  }
+
+  Ros2Executor(const Ros2Executor &) = delete;
+  Ros2Executor &operator=(const Ros2Executor &) = delete;
+
+  bool done() const { return m_finished; }
+  // The number of ticks with a sample older than the max_age option
+  uint64_t stale_ticks() const { return m_io.stale_ticks(); }
+
+private:
+  // Publishes the commands, loaned from the middleware when it supports loans
+  struct CmdPublisher {
+    void actuate(const ActuateCmd &cmd, std::chrono::steady_clock::time_point) {
+      if (publisher->can_loan_messages()) {
+        auto msg = publisher->borrow_loaned_message();
+        msg.get().linear.x = cmd.velocity;
+        publisher->publish(std::move(msg));
+      } else {
+        auto msg = std::make_unique<geometry_msgs::msg::Twist>();
+        msg->linear.x = cmd.velocity;
+        publisher->publish(std::move(msg));
+      }
+    }
+
+    rclcpp::Publisher<geometry_msgs::msg::Twist>::SharedPtr publisher;
+  };
+
+  static Services with_backend(Services svc, MessengerBackend *backend) {
+    svc.messenger.backend = backend;
+    return svc;
+  }
+
+  void on_tick() {
+    if (m_finished) {
+      return;
+    }
+    if (!m_started) {
+      m_run.start();
+      m_started = true;
+    }
+    auto out = m_run.step(std::chrono::steady_clock::now());
+    if (out.value != Outcome::Return::Running) {
+      m_timer->cancel();
+      m_run.stop();
+      m_finished = true;
+      if (m_done) {
+        m_done(out);
+      }
+    }
+  }
+
+  Ros2ExecutorOptions m_options;
+  Done m_done;
+
+  RosoutStreambuf m_rosout;
+  std::ostream m_rosout_stream;
+  AsyncMessenger m_messenger;
+
+  SenseChannel m_channel;
+  SenseInfo m_sense{}; // assembled by the sensor callbacks
+  CmdPublisher m_cmd;
+  ChannelIo<CmdPublisher> m_io;
+  ExecutorRun<ChannelIo<CmdPublisher>> m_run;
+  bool m_started{false};
+  bool m_finished{false};
+
+  rclcpp::CallbackGroup::SharedPtr m_sense_group;
+  rclcpp::CallbackGroup::SharedPtr m_tick_group;
+  rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr m_odometry;
+  rclcpp::Subscription<std_msgs::msg::Bool>::SharedPtr m_flinching;
+  rclcpp::Subscription<std_msgs::msg::Bool>::SharedPtr m_knee_jerking;
+  rclcpp::TimerBase::SharedPtr m_timer;
+};
+#endif
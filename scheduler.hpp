@@ -0,0 +1,67 @@
+#pragma once
+#include "clock.hpp"
+#include <chrono>
+#include <cstdint>
+
+// Policy applied when a tick runs past the deadline of the following tick.
+enum class OverrunPolicy {
+  Skip,    // drop the missed periods and realign to the next deadline on the original grid
+  CatchUp, // release the missed ticks back-to-back until the schedule is caught up
+};
+
+// The periodic schedule an executor ticks its element with.
+struct TickSchedule {
+  std::chrono::nanoseconds period{std::chrono::milliseconds{100}};
+  OverrunPolicy overrun{OverrunPolicy::Skip};
+  // Skip the ticks of an element whose WakeCondition is not met, the previous outcome is applied
+  // again instead
+  bool reactive{false};
+};
+
+// Fixed-rate tick scheduler. Deadlines are absolute points on a grid anchored at the start time,
+// start + k * period, so the time spent in a tick and the wake-up jitter of the OS never
+// accumulate into the period. Ticks that finish after the next deadline are counted as overruns
+// and handled according to the schedule's OverrunPolicy. The time and the sleep are taken from the
+// Clock, see clock.hpp.
+template <class Clock = SteadyClock> class PeriodicScheduler {
+public:
+  using time_point = typename Clock::time_point;
+
+  PeriodicScheduler(const TickSchedule &schedule, Clock &clock)
+      : m_schedule(schedule), m_clock(clock), m_deadline(clock.now()) {}
+
+  // Blocks until the next deadline and returns the time of the wake up.
+  time_point wait_next() {
+    m_deadline += m_schedule.period;
+
+    auto now = m_clock.now();
+    if (now > m_deadline) {
+      ++m_overruns;
+      if (m_schedule.overrun == OverrunPolicy::CatchUp) {
+        // the deadline stays on the grid, the missed ticks are released immediately
+        return now;
+      }
+      // realign to the first deadline on the grid that is still ahead of us
+      auto missed = (now - m_deadline) / m_schedule.period + 1;
+      m_deadline += missed * m_schedule.period;
+      m_skipped += static_cast<uint64_t>(missed);
+    }
+
+    m_clock.sleep_until(m_deadline);
+    return m_clock.now();
+  }
+
+  // The deadline of the current tick
+  time_point deadline() const { return m_deadline; }
+  // The number of ticks that ended after the following deadline
+  uint64_t overruns() const { return m_overruns; }
+  // The number of periods dropped by the Skip policy
+  uint64_t skipped() const { return m_skipped; }
+
+private:
+  TickSchedule m_schedule;
+  Clock &m_clock;
+  time_point m_deadline;
+  uint64_t m_overruns{0};
+  uint64_t m_skipped{0};
+};
@@ -0,0 +1,101 @@
+#pragma once
+#include "types.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Lock-free triple buffer handing the latest value from one producer thread to one consumer thread.
+// The producer fills the back slot in place and publishes it by swapping it with the middle slot;
+// the consumer swaps the middle slot with its front slot when a new value was published and reads
+// the front slot in place. Neither side waits for the other, the value is never copied by the
+// buffer, and the consumer always sees a complete value, the newest one published.
+template <class T> class TripleBuffer {
+public:
+  // Producer side: the slot to write the next value into
+  T &back() { return m_slots[m_back].value; }
+
+  // Producer side: makes the back slot the latest value
+  void publish() {
+    auto prev = m_middle.exchange(static_cast<uint8_t>(m_back | FRESH), std::memory_order_acq_rel);
+    m_back = prev & INDEX;
+  }
+
+  // Producer side: copies the value into the back slot and publishes it
+  void publish(const T &value) {
+    back() = value;
+    publish();
+  }
+
+  // Consumer side: the latest published value. The reference stays valid, and the value unchanged,
+  // until the next call to latest().
+  const T &latest() {
+    if (m_middle.load(std::memory_order_relaxed) & FRESH) {
+      auto prev = m_middle.exchange(m_front, std::memory_order_acq_rel);
+      m_front = prev & INDEX;
+    }
+    return m_slots[m_front].value;
+  }
+
+private:
+  static constexpr uint8_t INDEX = 0x3;
+  static constexpr uint8_t FRESH = 0x4;
+  static constexpr std::size_t CACHE_LINE = 64;
+
+  struct alignas(CACHE_LINE) Slot {
+    T value{};
+  };
+
+  Slot m_slots[3];
+  alignas(CACHE_LINE) std::atomic<uint8_t> m_middle{1};
+  alignas(CACHE_LINE) uint8_t m_back{0};  // owned by the producer
+  alignas(CACHE_LINE) uint8_t m_front{2}; // owned by the consumer
+};
+
+// The path of the sense samples from the sensor thread to the executor. The sensor thread writes
+// each sample once, stamped with the time it was measured, and the executor ticks the tree with a
+// reference to the newest sample in place.
+//
+//   // sensor thread
+//   auto &s = channel.back();
+//   s.measured_x = ...;
+//   s.ts = clock.now();
+//   channel.publish();
+using SenseChannel = TripleBuffer<SenseInfo>;
+
+// Robot I/O of an executor fed by a SenseChannel. The elements are ticked with the channel's latest
+// sample and the commands are forwarded to the Actuator, anything providing
+//
+//   void actuate(const ActuateCmd &cmd, time_point now);
+//
+// A sample older than max_age when it is ticked counts as stale.
+template <class Actuator> class ChannelIo {
+public:
+  using time_point = std::chrono::steady_clock::time_point;
+
+  ChannelIo(SenseChannel &channel, Actuator &actuator,
+            std::chrono::nanoseconds max_age = std::chrono::milliseconds{10})
+      : m_channel(channel), m_actuator(actuator), m_max_age(max_age) {}
+
+  const SenseInfo &sense(time_point now) {
+    const auto &s = m_channel.latest();
+    m_age = now - s.ts;
+    if (m_age > m_max_age) {
+      ++m_stale;
+    }
+    return s;
+  }
+
+  void actuate(const ActuateCmd &cmd, time_point now) { m_actuator.actuate(cmd, now); }
+
+  // The age of the sample of the last tick
+  std::chrono::nanoseconds age() const { return m_age; }
+  // The number of ticks with a sample older than max_age
+  uint64_t stale_ticks() const { return m_stale; }
+
+private:
+  SenseChannel &m_channel;
+  Actuator &m_actuator;
+  std::chrono::nanoseconds m_max_age;
+  std::chrono::nanoseconds m_age{};
+  uint64_t m_stale{0};
+};
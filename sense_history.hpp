@@ -0,0 +1,130 @@
+#pragma once
+#include "types.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Fixed-capacity history of the sense samples the executor ticked with, shared by every element of
+// the tree through Services::history. Instead of an array of SenseInfo the history stores every
+// signal in its own aligned array (structure of arrays), so a filter reads only the signal it
+// needs. Each sample is written twice, at i and i + CAPACITY, which keeps the newest n samples
+// contiguous in memory regardless of where the ring wraps; the query kernels are therefore plain,
+// branch free loops over contiguous arrays. The integer counts vectorize, the floating point sums
+// stay in order since the build does not let the compiler reassociate them.
+//
+// Queries over n samples use the newest min(n, size()) samples.
+class SenseHistory {
+public:
+  static constexpr std::size_t CAPACITY = 64;
+
+  void push(const SenseInfo &s) {
+    m_head = (m_head + 1) % CAPACITY;
+    m_size = std::min(m_size + 1, CAPACITY);
+
+    std::chrono::duration<double> t = s.ts.time_since_epoch();
+    for (auto i : {m_head, m_head + CAPACITY}) {
+      m_t[i] = t.count();
+      m_velocity[i] = s.measured_velocity;
+      m_x[i] = s.measured_x;
+      m_flinching[i] = s.is_flinching;
+      m_knee_jerking[i] = s.is_knee_jerking;
+    }
+  }
+
+  void clear() { m_size = 0; }
+  std::size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  // Mean of the measured velocity over the newest n samples
+  double average_velocity(std::size_t n) const { return mean(window(m_velocity, n), clamp(n)); }
+  // Mean of the measured position over the newest n samples
+  double average_x(std::size_t n) const { return mean(window(m_x, n), clamp(n)); }
+
+  // Velocity estimated from the measured positions, the least-squares slope of x over time of the
+  // newest n samples. Returns 0 with fewer than two samples.
+  double velocity_from_x(std::size_t n) const {
+    n = clamp(n);
+    if (n < 2) {
+      return 0;
+    }
+    const double *t = window(m_t, n);
+    const double *x = window(m_x, n);
+
+    // centered on the newest sample to keep the sums well conditioned
+    double t0 = t[n - 1];
+    double x0 = x[n - 1];
+    double st = 0, sx = 0, stt = 0, stx = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      double dt = t[i] - t0;
+      double dx = x[i] - x0;
+      st += dt;
+      sx += dx;
+      stt += dt * dt;
+      stx += dt * dx;
+    }
+    double denom = n * stt - st * st;
+    return denom > 0 ? (n * stx - st * sx) / denom : 0;
+  }
+
+  // True when the robot travelled less than min_travel over the newest n samples. Requires at least
+  // n samples, a short history is never considered stalled.
+  bool is_stalled(std::size_t n, double min_travel) const {
+    if (n == 0 || m_size < n) {
+      return false;
+    }
+    const double *x = window(m_x, n);
+    double lo = x[0], hi = x[0];
+    for (std::size_t i = 1; i < n; ++i) {
+      lo = std::min(lo, x[i]);
+      hi = std::max(hi, x[i]);
+    }
+    return hi - lo < min_travel;
+  }
+
+  // The number of the newest n samples in which the robot was flinching
+  std::size_t count_flinching(std::size_t n) const {
+    return count(window(m_flinching, n), clamp(n));
+  }
+  // The number of the newest n samples in which the robot was knee jerking
+  std::size_t count_knee_jerking(std::size_t n) const {
+    return count(window(m_knee_jerking, n), clamp(n));
+  }
+
+private:
+  static constexpr std::size_t ALIGN = 64;
+
+  std::size_t clamp(std::size_t n) const { return std::min(n, m_size); }
+
+  // The newest n samples of the signal, oldest first
+  template <class T> const T *window(const T (&signal)[2 * CAPACITY], std::size_t n) const {
+    return signal + m_head + CAPACITY + 1 - clamp(n);
+  }
+
+  static double mean(const double *p, std::size_t n) {
+    if (n == 0) {
+      return 0;
+    }
+    double sum = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      sum += p[i];
+    }
+    return sum / n;
+  }
+
+  static std::size_t count(const uint8_t *p, std::size_t n) {
+    std::size_t c = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      c += p[i];
+    }
+    return c;
+  }
+
+  alignas(ALIGN) double m_t[2 * CAPACITY]{}; // seconds on the executor's clock
+  alignas(ALIGN) double m_velocity[2 * CAPACITY]{};
+  alignas(ALIGN) double m_x[2 * CAPACITY]{};
+  alignas(ALIGN) uint8_t m_flinching[2 * CAPACITY]{};
+  alignas(ALIGN) uint8_t m_knee_jerking[2 * CAPACITY]{};
+  std::size_t m_head{CAPACITY - 1};
+  std::size_t m_size{0};
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+// Bounded, lock-free, single-producer/single-consumer ring buffer. One thread may push while
+// another thread pops; neither side ever blocks. The capacity must be a power of two so the
+// indices can wrap with a mask. The head and tail live on separate cache lines to keep the
+// producer and consumer from false sharing.
+template <class T, std::size_t Capacity> class SpscRing {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "SpscRing capacity must be a power of two");
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SpscRing records must be trivially copyable");
+
+public:
+  static constexpr std::size_t CAPACITY = Capacity;
+
+  // Producer side. Returns false when the ring is full, the record is not stored.
+  bool try_push(const T &value) {
+    auto head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail_cache == Capacity) {
+      m_tail_cache = m_tail.load(std::memory_order_acquire);
+      if (head - m_tail_cache == Capacity) {
+        return false;
+      }
+    }
+    m_slots[head & MASK] = value;
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false when the ring is empty.
+  bool try_pop(T &value) {
+    auto tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_head_cache) {
+      m_head_cache = m_head.load(std::memory_order_acquire);
+      if (tail == m_head_cache) {
+        return false;
+      }
+    }
+    value = m_slots[tail & MASK];
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Approximate number of stored records, exact only when both sides are idle.
+  std::size_t size() const {
+    return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+
+private:
+  static constexpr std::size_t MASK = Capacity - 1;
+  static constexpr std::size_t CACHE_LINE = 64;
+
+  // written by the producer
+  alignas(CACHE_LINE) std::atomic<std::size_t> m_head{0};
+  std::size_t m_tail_cache{0};
+  // written by the consumer
+  alignas(CACHE_LINE) std::atomic<std::size_t> m_tail{0};
+  std::size_t m_head_cache{0};
+
+  alignas(CACHE_LINE) std::array<T, Capacity> m_slots{};
+};
@@ -0,0 +1,223 @@
+#pragma once
+#include "behavior_element.hpp"
+#include "profiling.hpp"
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <vector>
+
+// A table-driven state machine whose states are BehaviorElements. A state runs until it completes,
+// its outcome selects the next state from the transition table; a guard, a predicate on the sense,
+// preempts the running state. A state may itself be a composite or another StateMachineElement,
+// which makes the machine hierarchical.
+//
+//   StateMachineElement::Definition def;
+//   auto walk = def.state(walk_to_dock);
+//   auto stop = def.state(stop_element);
+//   def.on(walk, Outcome::Return::Success, stop);
+//   def.on(walk, Outcome::Return::Fail, StateMachineElement::FAIL);
+//   def.when(walk, [](const SenseInfo &s) { return s.is_flinching; }, stop, SenseField_FLINCHING);
+//   StateMachineElement machine(def);
+//
+// An outcome without a transition ends the machine with that outcome, the machine starts in the
+// first state. The definition is resolved into contiguous tables when the machine is constructed:
+// the outcome transitions are one array indexed by state and outcome, and the guards of a state are
+// a range of one array, so choosing the next state is an indexed load instead of a chain of
+// conditionals.
+//
+// A state completing hands over like a SequenceElement: the machine stays running with the state's
+// command and the next state starts on the next tick. A guard is evaluated at the start of a tick,
+// before the running state is ticked; a firing guard finalizes the running state and the target
+// state starts and is ticked in the same tick.
+class StateMachineElement : public BehaviorElement {
+public:
+  using StateId = uint16_t;
+  using Guard = bool (*)(const SenseInfo &);
+
+  // Transition targets ending the machine
+  static constexpr StateId SUCCESS = 0xFFFF;
+  static constexpr StateId FAIL = 0xFFFE;
+  static constexpr StateId MAX_STATES = 0xFFF0;
+
+  // The states and transitions of a machine, resolved by the StateMachineElement's constructor
+  class Definition {
+  public:
+    StateId state(BehaviorElement &element) {
+      assert(m_states.size() < MAX_STATES && "too many states");
+      m_states.push_back(std::ref(element));
+      m_transitions.push_back(SUCCESS);
+      m_transitions.push_back(FAIL);
+      return static_cast<StateId>(m_states.size() - 1);
+    }
+
+    // The state following from once it completes with the outcome
+    void on(StateId from, Outcome::Return outcome, StateId to) {
+      assert(outcome != Outcome::Return::Running && "a running state does not transition");
+      m_transitions[from * 2 + outcome_index(outcome)] = to;
+    }
+
+    // Preempts the state from with the state to when the guard is true. The sense_mask holds the
+    // SenseFields the guard reads, for reactive executors. Guards are evaluated in the order added.
+    void when(StateId from, Guard guard, StateId to, uint32_t sense_mask = SenseField_ALL) {
+      m_guards.push_back(GuardDef{from, GuardEntry{guard, sense_mask, to}});
+    }
+
+  private:
+    friend class StateMachineElement;
+
+    struct GuardEntry {
+      Guard guard;
+      uint32_t sense_mask;
+      StateId to;
+    };
+    struct GuardDef {
+      StateId from;
+      GuardEntry entry;
+    };
+
+    std::vector<std::reference_wrapper<BehaviorElement>> m_states;
+    std::vector<StateId> m_transitions;
+    std::vector<GuardDef> m_guards;
+  };
+
+  explicit StateMachineElement(const Definition &def, const char *name = "StateMachine",
+                               std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+      : m_name(name), m_states(def.m_states.begin(), def.m_states.end(), mr),
+        m_transitions(def.m_transitions.begin(), def.m_transitions.end(), mr),
+        m_guard_begin(def.m_states.size() + 1, 0, mr), m_guards(mr),
+        m_guard_masks(def.m_states.size(), 0, mr), m_meta(def.m_states.size(), ElementMeta{}, mr) {
+    // bucket the guards by state, keeping their order within a state
+    for (auto &g : def.m_guards) {
+      ++m_guard_begin[g.from + 1];
+      m_guard_masks[g.from] |= g.entry.sense_mask;
+    }
+    for (std::size_t i = 1; i < m_guard_begin.size(); ++i) {
+      m_guard_begin[i] += m_guard_begin[i - 1];
+    }
+    m_guards.resize(def.m_guards.size());
+    std::pmr::vector<uint32_t> fill(m_guard_begin.begin(), m_guard_begin.end() - 1, mr);
+    for (auto &g : def.m_guards) {
+      m_guards[fill[g.from]++] = g.entry;
+    }
+  }
+
+  ElementMeta initialize(const Services &svc) override {
+    m_svcs = &svc;
+    m_state = 0;
+    m_new_state = true;
+    return ElementMeta{m_name};
+  }
+
+  Outcome tick(const SenseInfo &s) override {
+    Outcome o;
+    if (m_state >= m_states.size()) {
+      // we arrive here when the machine never had any states, or ticks after it completed
+      o.value = Outcome::Return::Fail;
+      return o;
+    }
+
+    // preempt the running state on a guard
+    if (!m_new_state) {
+      for (auto i = m_guard_begin[m_state]; i < m_guard_begin[m_state + 1]; ++i) {
+        if (m_guards[i].guard(s)) {
+          finalize_state();
+          if (!enter(m_guards[i].to, o)) {
+            return o;
+          }
+          break;
+        }
+      }
+    }
+
+    if (m_new_state) {
+      m_meta[m_state] = state().initialize(*m_svcs);
+      m_svcs->lifecycle.emit(LifecycleKind_INITIALIZE, &state(), m_meta[m_state].name);
+      m_new_state = false;
+    }
+
+    m_svcs->lifecycle.emit(LifecycleKind_TICK, &state(), m_meta[m_state].name);
+    {
+      ProfileScope profile(m_meta[m_state].name);
+      o = state().tick(s);
+    }
+
+    if (o.value != Outcome::Return::Running) {
+      finalize_state(o.value);
+      if (enter(m_transitions[m_state * 2 + outcome_index(o.value)], o)) {
+        // maintain that the machine is still running, the next state takes over
+        o.value = Outcome::Return::Running;
+      }
+    }
+    return o;
+  }
+
+  Footprint footprint() const override {
+    Footprint f{sizeof(*this) + bytes(m_states) + bytes(m_transitions) + bytes(m_guard_begin) +
+                    bytes(m_guards) + bytes(m_guard_masks) + bytes(m_meta),
+                1, 0};
+    for (const auto &state : m_states) {
+      f = f + state.get().footprint();
+    }
+    return f;
+  }
+
+  WakeCondition wake_condition() const override {
+    if (m_new_state || m_state >= m_states.size()) {
+      // the next state has to be initialized on the next tick
+      return WakeCondition{};
+    }
+    auto wake = m_states[m_state].get().wake_condition();
+    wake.sense_mask |= m_guard_masks[m_state];
+    return wake;
+  }
+
+  void finalize() override {
+    // finalize a state preempted by the machine's completion
+    if (!m_new_state && m_state < m_states.size()) {
+      finalize_state();
+      m_new_state = true;
+    }
+  }
+
+private:
+  template <class T> static std::size_t bytes(const std::pmr::vector<T> &v) {
+    return v.capacity() * sizeof(T);
+  }
+
+  static std::size_t outcome_index(Outcome::Return outcome) {
+    return outcome == Outcome::Return::Success ? 0 : 1;
+  }
+
+  BehaviorElement &state() { return m_states[m_state].get(); }
+
+  // The outcome is the one the state completed with, Running when it is preempted
+  void finalize_state(Outcome::Return outcome = Outcome::Return::Running) {
+    state().finalize();
+    m_svcs->lifecycle.emit(LifecycleKind_FINALIZE, &state(), m_meta[m_state].name, outcome);
+  }
+
+  // Moves to the target state. False when the target ends the machine, the outcome is set to it.
+  bool enter(StateId to, Outcome &o) {
+    m_new_state = true;
+    if (to == SUCCESS || to == FAIL) {
+      o.value = to == SUCCESS ? Outcome::Return::Success : Outcome::Return::Fail;
+      m_state = static_cast<StateId>(m_states.size());
+      return false;
+    }
+    m_state = to;
+    return true;
+  }
+
+  const char *m_name;
+  std::pmr::vector<std::reference_wrapper<BehaviorElement>> m_states;
+  std::pmr::vector<StateId> m_transitions; // [state * 2 + outcome_index] -> next state
+  std::pmr::vector<uint32_t> m_guard_begin; // the guards of state i are [begin[i], begin[i + 1])
+  std::pmr::vector<Definition::GuardEntry> m_guards;
+  std::pmr::vector<uint32_t> m_guard_masks; // the sense fields read by the guards of a state
+  std::pmr::vector<ElementMeta> m_meta;
+
+  const Services *m_svcs{&Services::none()};
+  StateId m_state{0};
+  bool m_new_state{true};
+};
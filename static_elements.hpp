@@ -0,0 +1,384 @@
+#pragma once
+#include "motion_element.hpp"
+#include "profiling.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Static composites are the compile-time counterparts of the SequenceElement. The children are
+// stored by value (or by reference when a reference type is given) in a std::tuple, so the type of
+// every child is known where it is ticked. A tick is dispatched to the active child through an
+// index switch generated from the tuple's indices; each branch calls the concrete child directly,
+// which allows the compiler to inline the whole tree rather than going through the BehaviorElement
+// vtable at every level.
+//
+//   StaticSequence walk_then_stop(WalkToPosition{4}, Stop{});
+//   Executor::run(walk_then_stop);
+//
+// The reactions of the MotionElement children are known at compile time as well: REACTION_TABLE
+// holds each child's set and REACTION_UNION every reaction of the tree. The ordered composites apply
+// their MotionElement children's reactions on their behalf, a hand-off between two children is a
+// single ReactionSvc::transition of the difference between their sets.
+//
+// The static composites still implement BehaviorElement, so they can be the root of an executor or
+// a child of a dynamic composite.
+
+namespace static_detail {
+template <class T> using Element = std::remove_cv_t<std::remove_reference_t<T>>;
+
+template <class T> constexpr bool is_motion_element() {
+  return std::is_base_of<MotionElement<T>, T>::value;
+}
+
+template <class T, class = void> struct has_reaction_union : std::false_type {};
+template <class T>
+struct has_reaction_union<T, std::void_t<decltype(T::REACTION_UNION)>> : std::true_type {};
+
+// The reactions a composite applies on behalf of the child: a MotionElement child's reactions are
+// applied by its parent, any other child manages its own.
+template <class T> constexpr ReactionSet delegated_reactions() {
+  if constexpr (is_motion_element<T>()) {
+    return T::reactions();
+  } else {
+    return 0;
+  }
+}
+
+// Every reaction the child's subtree may enable, as far as it is known at compile time
+template <class T> constexpr ReactionSet subtree_reactions() {
+  if constexpr (is_motion_element<T>()) {
+    return T::reactions();
+  } else if constexpr (has_reaction_union<T>::value) {
+    return T::REACTION_UNION;
+  } else {
+    return 0;
+  }
+}
+
+// Invokes fn on the index'th element of the tuple. The fold expands into a chain of compares the
+// compiler turns into a jump table, each branch being a direct call on the element's concrete type.
+template <class R, class Tuple, class Fn, std::size_t... Is>
+R visit_at(Tuple &elements, std::size_t index, Fn &&fn, std::index_sequence<Is...>) {
+  R r{};
+  static_cast<void>(
+      ((index == Is ? (r = fn(std::get<Is>(elements)), true) : false) || ...));
+  return r;
+}
+} // namespace static_detail
+
+// Common storage and dispatch for the static composites
+template <class... Ts> class StaticComposite : public BehaviorElement {
+public:
+  static constexpr std::size_t SIZE = sizeof...(Ts);
+
+  // The reactions of each MotionElement child, 0 for children managing their own reactions
+  static constexpr std::array<ReactionSet, SIZE> REACTION_TABLE{
+      static_detail::delegated_reactions<static_detail::Element<Ts>>()...};
+  // Every reaction the tree may enable
+  static constexpr ReactionSet REACTION_UNION =
+      (static_detail::subtree_reactions<static_detail::Element<Ts>>() | ... | ReactionSet{0});
+
+  explicit StaticComposite(Ts... elements) : m_elements(std::forward<Ts>(elements)...) {}
+
+protected:
+  template <class R, class Fn> R visit(std::size_t index, Fn &&fn) {
+    return static_detail::visit_at<R>(m_elements, index, std::forward<Fn>(fn),
+                                      std::index_sequence_for<Ts...>{});
+  }
+
+  template <class R, class Fn> R visit_const(std::size_t index, Fn &&fn) const {
+    return static_detail::visit_at<R>(m_elements, index, std::forward<Fn>(fn),
+                                      std::index_sequence_for<Ts...>{});
+  }
+
+  // Initializes the child. With delegate the reactions of a MotionElement child are not applied by
+  // the child, the composite applies them.
+  void initialize_child(std::size_t index, bool delegate) {
+    m_meta[index] = visit<ElementMeta>(index, [this, delegate](auto &e) {
+      using T = static_detail::Element<decltype(e)>;
+      if constexpr (static_detail::is_motion_element<T>()) {
+        if (delegate) {
+          return e.initialize_delegated(*m_svcs);
+        }
+      }
+      return e.initialize(*m_svcs);
+    });
+    m_svcs->lifecycle.emit(LifecycleKind_INITIALIZE, address(index), m_meta[index].name);
+  }
+
+  Outcome tick_child(std::size_t index, const SenseInfo &s) {
+    m_svcs->lifecycle.emit(LifecycleKind_TICK, address(index), m_meta[index].name);
+    ProfileScope profile(m_meta[index].name);
+    return visit<Outcome>(index, [&s](auto &e) { return e.tick(s); });
+  }
+
+  // The outcome is the one the child completed with, Running when it is finalized while running
+  void finalize_child(std::size_t index, Outcome::Return outcome) {
+    visit<bool>(index, [](auto &e) {
+      e.finalize();
+      return true;
+    });
+    m_svcs->lifecycle.emit(LifecycleKind_FINALIZE, address(index), m_meta[index].name, outcome);
+  }
+
+  const void *address(std::size_t index) {
+    return visit<const void *>(index, [](auto &e) -> const void * { return &e; });
+  }
+
+  // The footprint of a composite of the given size and its children. The children held by value are
+  // part of the composite, only those held by reference add their own size.
+  Footprint subtree_footprint(std::size_t bytes) const {
+    return subtree_footprint(Footprint{bytes, 1, 0}, std::index_sequence_for<Ts...>{});
+  }
+
+  const Services *m_svcs{&Services::none()};
+  std::tuple<Ts...> m_elements;
+  std::array<ElementMeta, SIZE> m_meta{};
+
+private:
+  template <std::size_t... Is>
+  Footprint subtree_footprint(Footprint f, std::index_sequence<Is...>) const {
+    static_cast<void>(((f = f + child_footprint<Is>()), ...));
+    return f;
+  }
+
+  template <std::size_t I> Footprint child_footprint() const {
+    using T = std::tuple_element_t<I, std::tuple<Ts...>>;
+    auto f = std::get<I>(m_elements).footprint();
+    if constexpr (!std::is_reference<T>::value) {
+      f.bytes -= std::min(f.bytes, sizeof(T));
+    }
+    return f;
+  }
+};
+
+// Executes its children one after the other. The composite moves to the next child when the active
+// child returns CONTINUE_ON, and ends on the first child returning anything else, or after the last
+// child. A StaticSequence continues on Success (AND), a StaticFallback continues on Fail (OR).
+template <Outcome::Return CONTINUE_ON, class... Ts>
+class StaticOrdered : public StaticComposite<Ts...> {
+  using Base = StaticComposite<Ts...>;
+
+public:
+  using Base::Base;
+
+  Outcome tick(const SenseInfo &s) final {
+    Outcome o;
+    o.value = Outcome::Return::Running;
+
+    if (m_index < Base::SIZE) {
+      if (m_new_element) {
+        apply_reactions(Base::REACTION_TABLE[m_index]);
+        this->initialize_child(m_index, true);
+        m_new_element = false;
+      }
+
+      auto cur_o = this->tick_child(m_index, s);
+
+      if (cur_o.value != Outcome::Return::Running) {
+        this->finalize_child(m_index, cur_o.value);
+
+        // go to the next element
+        m_new_element = true;
+        ++m_index;
+        if (m_index < Base::SIZE && cur_o.value == CONTINUE_ON) {
+          // maintain that this element is still running, the next child takes over
+          o.actuate = cur_o.actuate;
+          // hand the reactions over in one update
+          apply_reactions(Base::REACTION_TABLE[m_index]);
+        } else {
+          // done, forward the outcome of the last child
+          o = cur_o;
+          apply_reactions(0);
+        }
+      } else {
+        o = cur_o;
+      }
+    } else {
+      // we arrive here when the composite never had any elements
+      o.value = Outcome::Return::Fail;
+    }
+
+    return o;
+  }
+
+  WakeCondition wake_condition() const final {
+    if (m_new_element || m_index >= Base::SIZE) {
+      // the next child has to be initialized on the next tick
+      return WakeCondition{};
+    }
+    return this->template visit_const<WakeCondition>(
+        m_index, [](const auto &e) { return e.wake_condition(); });
+  }
+
+  void finalize() final {
+    // finalize a child that did not run to completion
+    if (!m_new_element && m_index < Base::SIZE) {
+      this->finalize_child(m_index, Outcome::Return::Running);
+      m_new_element = true;
+    }
+    apply_reactions(0);
+  }
+
+protected:
+  void reset(const Services &svc) {
+    this->m_svcs = &svc;
+    m_index = 0;
+    m_new_element = true;
+    m_applied = 0;
+  }
+
+private:
+  // Changes the reactions applied for the MotionElement children to the given set, releasing and
+  // activating only the difference. Children sharing a reaction keep it enabled across the hand-off.
+  void apply_reactions(ReactionSet next) {
+    if (next != m_applied) {
+      this->m_svcs->reaction_svc.transition(m_applied & ~next, next & ~m_applied);
+      m_applied = next;
+    }
+  }
+
+  std::size_t m_index{0};
+  bool m_new_element{true};
+  ReactionSet m_applied{0};
+};
+
+// The static counterpart of the SequenceElement, an 'AND' of its children.
+template <class... Ts>
+class StaticSequence final : public StaticOrdered<Outcome::Return::Success, Ts...> {
+public:
+  explicit StaticSequence(Ts... elements)
+      : StaticOrdered<Outcome::Return::Success, Ts...>(std::forward<Ts>(elements)...) {}
+
+  ElementMeta initialize(const Services &svc) final {
+    this->reset(svc);
+    return ElementMeta{"StaticSequence"};
+  }
+
+  Footprint footprint() const final { return this->subtree_footprint(sizeof(*this)); }
+};
+
+// Executes its children in order until one succeeds, an 'OR' of its children. The fallback fails
+// when every child failed.
+template <class... Ts>
+class StaticFallback final : public StaticOrdered<Outcome::Return::Fail, Ts...> {
+public:
+  explicit StaticFallback(Ts... elements)
+      : StaticOrdered<Outcome::Return::Fail, Ts...>(std::forward<Ts>(elements)...) {}
+
+  ElementMeta initialize(const Services &svc) final {
+    this->reset(svc);
+    return ElementMeta{"StaticFallback"};
+  }
+
+  Footprint footprint() const final { return this->subtree_footprint(sizeof(*this)); }
+};
+
+// Ticks all of its children on every tick. The parallel succeeds once success_threshold children
+// succeeded and fails once failure_threshold children failed; by default it requires every child to
+// succeed and fails on the first failure. The actuation command is taken from the lowest indexed
+// child ticked during the tick, which keeps the output deterministic.
+template <class... Ts> class StaticParallel final : public StaticComposite<Ts...> {
+  using Base = StaticComposite<Ts...>;
+
+public:
+  explicit StaticParallel(Ts... elements) : Base(std::forward<Ts>(elements)...) {}
+
+  void set_thresholds(std::size_t success_threshold, std::size_t failure_threshold) {
+    m_success_threshold = success_threshold;
+    m_failure_threshold = failure_threshold;
+  }
+
+  ElementMeta initialize(const Services &svc) final {
+    this->m_svcs = &svc;
+    m_state.fill(ChildState::Idle);
+    m_successes = 0;
+    m_failures = 0;
+    return ElementMeta{"StaticParallel"};
+  }
+
+  Outcome tick(const SenseInfo &s) final {
+    Outcome o;
+    o.value = Outcome::Return::Running;
+    bool has_actuate = false;
+
+    for (std::size_t i = 0; i < Base::SIZE; ++i) {
+      if (m_state[i] == ChildState::Done) {
+        continue;
+      }
+      if (m_state[i] == ChildState::Idle) {
+        // the children overlap, each applies its own reactions
+        this->initialize_child(i, false);
+        m_state[i] = ChildState::Active;
+      }
+
+      auto cur_o = this->tick_child(i, s);
+      if (!has_actuate) {
+        o.actuate = cur_o.actuate;
+        has_actuate = true;
+      }
+
+      if (cur_o.value != Outcome::Return::Running) {
+        this->finalize_child(i, cur_o.value);
+        m_state[i] = ChildState::Done;
+        if (cur_o.value == Outcome::Return::Success) {
+          ++m_successes;
+        } else {
+          ++m_failures;
+        }
+      }
+    }
+
+    if (m_failures >= m_failure_threshold || Base::SIZE == 0) {
+      o.value = Outcome::Return::Fail;
+    } else if (m_successes >= m_success_threshold) {
+      o.value = Outcome::Return::Success;
+    } else if (m_successes + m_failures == Base::SIZE) {
+      // every child is done, but the success threshold cannot be met anymore
+      o.value = Outcome::Return::Fail;
+    }
+
+    if (o.value != Outcome::Return::Running) {
+      finalize();
+    }
+    return o;
+  }
+
+  WakeCondition wake_condition() const final {
+    WakeCondition wake{0, WakeCondition{}.deadline};
+    for (std::size_t i = 0; i < Base::SIZE; ++i) {
+      if (m_state[i] == ChildState::Idle) {
+        return WakeCondition{};
+      }
+      if (m_state[i] == ChildState::Active) {
+        wake = wake | this->template visit_const<WakeCondition>(
+                          i, [](const auto &e) { return e.wake_condition(); });
+      }
+    }
+    return wake;
+  }
+
+  Footprint footprint() const final { return this->subtree_footprint(sizeof(*this)); }
+
+  void finalize() final {
+    // finalize the children still running when the parallel completes
+    for (std::size_t i = 0; i < Base::SIZE; ++i) {
+      if (m_state[i] == ChildState::Active) {
+        this->finalize_child(i, Outcome::Return::Running);
+        m_state[i] = ChildState::Done;
+      }
+    }
+  }
+
+private:
+  enum class ChildState : uint8_t { Idle, Active, Done };
+
+  std::array<ChildState, Base::SIZE> m_state{};
+  std::size_t m_successes{0};
+  std::size_t m_failures{0};
+  std::size_t m_success_threshold{Base::SIZE};
+  std::size_t m_failure_threshold{1};
+};
@@ -0,0 +1,250 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// A fixed pool of work-stealing worker threads for fork-join work. The workers are started once and
+// reused, so a periodic executor does not create threads per tick.
+//
+// Every thread has its own task queue. A thread pushes and pops its own queue at the back and, when
+// it runs dry, steals from the front of the other queues, which keeps the queues mostly uncontended
+// and spreads nested work across the pool. A task is a plain function pointer with its arguments
+// and the queues are fixed-capacity rings, so submitting never allocates. Waiting on a TaskGroup
+// runs queued tasks instead of blocking, which allows fork-join work to nest, e.g. a
+// ParallelElement ticked by a BatchExecutor worker.
+//
+// A queue holds QUEUE_CAPACITY tasks. A task submitted to a full queue runs on the submitting
+// thread instead, so a caller submitting more tasks than that at once becomes partly serial. Work
+// split into many more items than threads goes through parallel_for(), or a task per thread
+// taking the next item from a shared counter, e.g. the MissionPlanner.
+class ThreadPool {
+public:
+  // Completion counter of a group of tasks submitted together
+  class TaskGroup {
+  public:
+    bool done() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+  private:
+    friend class ThreadPool;
+    std::atomic<std::size_t> m_pending{0};
+  };
+
+  using TaskFn = void (*)(void *ctx, std::size_t arg);
+
+  // The tasks a thread's queue holds before submit() runs the next task inline
+  static constexpr std::size_t QUEUE_CAPACITY = 256;
+
+  // The total number of threads taking part in the work, including a thread waiting on a group
+  explicit ThreadPool(std::size_t threads = std::max(1u, std::thread::hardware_concurrency())) {
+    threads = std::max<std::size_t>(threads, 1);
+    // queue 0 is shared by the threads outside of the pool
+    for (std::size_t i = 0; i < threads; ++i) {
+      m_queues.push_back(std::make_unique<Queue>());
+    }
+    m_workers.reserve(threads - 1);
+    for (std::size_t i = 1; i < threads; ++i) {
+      m_workers.emplace_back([this, i] { work(i); });
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(m_sleep_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto &w : m_workers) {
+      w.join();
+    }
+  }
+
+  std::size_t size() const { return m_queues.size(); }
+
+  // Queues fn(ctx, arg) as part of the group. The context must outlive the group's wait(). When the
+  // thread's queue holds QUEUE_CAPACITY tasks already, fn runs on the calling thread before the call
+  // returns.
+  void submit(TaskGroup &group, TaskFn fn, void *ctx, std::size_t arg) {
+    auto &q = *m_queues[home()];
+    bool queued;
+    {
+      std::lock_guard<std::mutex> lock(q.mutex);
+      queued = q.push_back(Task{fn, ctx, arg, &group});
+      if (queued) {
+        group.m_pending.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    if (!queued) {
+      fn(ctx, arg);
+      return;
+    }
+    // sequentially consistent with the sleeping workers' check of m_queued, see work()
+    m_queued.fetch_add(1);
+    if (m_sleeping.load() > 0) {
+      { std::lock_guard<std::mutex> lock(m_sleep_mutex); }
+      m_wake.notify_one();
+    }
+  }
+
+  // Runs queued tasks, of any group, until every task of the group completed
+  void wait(TaskGroup &group) {
+    auto index = home();
+    while (!group.done()) {
+      if (!try_run_one(index)) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  // Splits [0, count) into one contiguous range per thread and calls fn(begin, end) for each range.
+  // The calling thread works on the first range and the call returns after every range is done.
+  // The ranges are never more than the calling thread's queue holds, whatever the pool's size.
+  template <class Fn> void parallel_for(std::size_t count, Fn &&fn) {
+    if (count == 0) {
+      return;
+    }
+
+    struct Loop {
+      std::remove_reference_t<Fn> *fn;
+      std::size_t count;
+      std::size_t chunk_size;
+    };
+    auto chunks = std::min({size(), count, QUEUE_CAPACITY + 1});
+    Loop loop{&fn, count, (count + chunks - 1) / chunks};
+
+    TaskFn run_chunk = [](void *ctx, std::size_t chunk) {
+      auto &l = *static_cast<Loop *>(ctx);
+      auto begin = chunk * l.chunk_size;
+      auto end = std::min(begin + l.chunk_size, l.count);
+      if (begin < end) {
+        (*l.fn)(begin, end);
+      }
+    };
+
+    TaskGroup group;
+    for (std::size_t chunk = 1; chunk < chunks; ++chunk) {
+      submit(group, run_chunk, &loop, chunk);
+    }
+    run_chunk(&loop, 0);
+    wait(group);
+  }
+
+private:
+  struct Task {
+    TaskFn fn;
+    void *ctx;
+    std::size_t arg;
+    TaskGroup *group;
+  };
+
+  // A ring of tasks, pushed and popped at the back by its thread and stolen from the front. The
+  // indices only grow, the slot of an index is the index modulo the capacity.
+  struct alignas(64) Queue {
+    bool empty() const { return head == tail; }
+
+    bool push_back(const Task &task) {
+      if (tail - head == QUEUE_CAPACITY) {
+        return false;
+      }
+      tasks[tail++ % QUEUE_CAPACITY] = task;
+      return true;
+    }
+    Task pop_back() { return tasks[--tail % QUEUE_CAPACITY]; }
+    Task pop_front() { return tasks[head++ % QUEUE_CAPACITY]; }
+
+    std::mutex mutex;
+    std::size_t head{0};
+    std::size_t tail{0};
+    Task tasks[QUEUE_CAPACITY];
+  };
+
+  // The queue owned by the calling thread, the threads outside of the pool share queue 0
+  std::size_t home() const { return tl_pool == this ? tl_index : 0; }
+
+  // Pops a task from the thread's own queue, or steals one from another queue, and runs it
+  bool try_run_one(std::size_t index) {
+    Task task;
+    if (!pop(index, task)) {
+      return false;
+    }
+    task.fn(task.ctx, task.arg);
+    task.group->m_pending.fetch_sub(1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(std::size_t index, Task &task) {
+    if (m_queued.load(std::memory_order_acquire) == 0) {
+      return false;
+    }
+    // own queue, newest first
+    {
+      auto &q = *m_queues[index];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      if (!q.empty()) {
+        task = q.pop_back();
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+    // steal from the other queues, oldest first
+    for (std::size_t n = 1; n < m_queues.size(); ++n) {
+      auto &q = *m_queues[(index + n) % m_queues.size()];
+      std::unique_lock<std::mutex> lock(q.mutex, std::try_to_lock);
+      if (lock.owns_lock() && !q.empty()) {
+        task = q.pop_front();
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void work(std::size_t index) {
+    tl_pool = this;
+    tl_index = index;
+
+    constexpr int SPINS = 256;
+    int idle = 0;
+    for (;;) {
+      if (try_run_one(index)) {
+        idle = 0;
+        continue;
+      }
+      // spin briefly before sleeping, a fork-join tick usually submits again within microseconds
+      if (++idle < SPINS) {
+        std::this_thread::yield();
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(m_sleep_mutex);
+      // announce the sleep before checking the queues, a submitter either sees the announcement
+      // and wakes us, or we see its task
+      m_sleeping.fetch_add(1);
+      m_wake.wait(lock, [this] { return m_stop || m_queued.load() > 0; });
+      m_sleeping.fetch_sub(1);
+      if (m_stop) {
+        return;
+      }
+      idle = 0;
+    }
+  }
+
+  static inline thread_local const ThreadPool *tl_pool = nullptr;
+  static inline thread_local std::size_t tl_index = 0;
+
+  std::vector<std::unique_ptr<Queue>> m_queues;
+  std::vector<std::thread> m_workers;
+  std::atomic<std::size_t> m_queued{0};
+  std::atomic<std::size_t> m_sleeping{0};
+  std::mutex m_sleep_mutex;
+  std::condition_variable m_wake;
+  bool m_stop{false};
+};
@@ -0,0 +1,192 @@
+#include "parallel_element.hpp"
+#include "thread_pool.hpp"
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Checks that every task submitted to a ThreadPool runs exactly once, also when more tasks are
+// submitted than a queue holds and the overflow runs on the submitting thread, from outside of the
+// pool and nested in a task, and that parallel_for covers its range once whatever the pool's size.
+// Checks the success and failure thresholds of a ParallelElement ticking on the pool.
+
+namespace {
+
+int failed = 0;
+
+void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::printf("FAILED: %s\n", what.c_str());
+    ++failed;
+  }
+}
+
+struct Runs {
+  explicit Runs(std::size_t n) : counts(n) {}
+
+  bool once() const {
+    for (const auto &c : counts) {
+      if (c.load() != 1) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::vector<std::atomic<int>> counts;
+};
+
+void count_run(void *ctx, std::size_t i) { static_cast<Runs *>(ctx)->counts[i].fetch_add(1); }
+
+void test_overflow() {
+  constexpr std::size_t TASKS = 4 * ThreadPool::QUEUE_CAPACITY;
+  for (std::size_t threads : {1, 2, 4}) {
+    ThreadPool pool(threads);
+    Runs runs(TASKS);
+    ThreadPool::TaskGroup group;
+    for (std::size_t i = 0; i < TASKS; ++i) {
+      pool.submit(group, &count_run, &runs, i);
+    }
+    pool.wait(group);
+    check(group.done() && runs.once(),
+          "every task of an overflowing queue runs once, threads=" + std::to_string(threads));
+  }
+}
+
+struct Nested {
+  ThreadPool *pool;
+  std::vector<std::unique_ptr<Runs>> runs;
+};
+
+// submits more tasks than the worker's own queue holds, from inside of a task
+void run_nested(void *ctx, std::size_t i) {
+  auto &n = *static_cast<Nested *>(ctx);
+  auto &runs = *n.runs[i];
+  ThreadPool::TaskGroup group;
+  for (std::size_t j = 0; j < runs.counts.size(); ++j) {
+    n.pool->submit(group, &count_run, &runs, j);
+  }
+  n.pool->wait(group);
+}
+
+void test_nested_overflow() {
+  ThreadPool pool(4);
+  Nested nested{&pool, {}};
+  for (std::size_t i = 0; i < 8; ++i) {
+    nested.runs.push_back(std::make_unique<Runs>(2 * ThreadPool::QUEUE_CAPACITY));
+  }
+  ThreadPool::TaskGroup group;
+  for (std::size_t i = 0; i < nested.runs.size(); ++i) {
+    pool.submit(group, &run_nested, &nested, i);
+  }
+  pool.wait(group);
+  bool once = true;
+  for (const auto &r : nested.runs) {
+    once &= r->once();
+  }
+  check(once, "every nested task runs once");
+}
+
+void test_parallel_for() {
+  for (std::size_t threads : {std::size_t{1}, std::size_t{3}, ThreadPool::QUEUE_CAPACITY + 8}) {
+    ThreadPool pool(threads);
+    for (std::size_t count : {0, 1, 7, 1000}) {
+      Runs runs(count);
+      pool.parallel_for(count, [&runs](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; ++i) {
+          runs.counts[i].fetch_add(1);
+        }
+      });
+      check(runs.once(), "parallel_for covers its range once, threads=" + std::to_string(threads) +
+                             " count=" + std::to_string(count));
+    }
+  }
+}
+
+// A leaf completing with its outcome on its nth tick, commanding its velocity on every tick
+class Leaf : public BehaviorElement {
+public:
+  Leaf(int ticks, Outcome::Return outcome, double velocity)
+      : m_ticks(ticks), m_outcome(outcome), m_velocity(velocity) {}
+
+  ElementMeta initialize(const Services &) override {
+    m_ticked = 0;
+    return {"Leaf"};
+  }
+
+  Outcome tick(const SenseInfo &) override {
+    Outcome o;
+    o.actuate.velocity = m_velocity;
+    o.value = ++m_ticked < m_ticks ? Outcome::Return::Running : m_outcome;
+    return o;
+  }
+
+  void finalize() override {}
+
+private:
+  int m_ticks;
+  Outcome::Return m_outcome;
+  double m_velocity;
+  int m_ticked{0};
+};
+
+// Ticks the parallel until it completes, returns its outcome and the number of ticks it took
+std::pair<Outcome, int> run(ParallelElement &parallel) {
+  Services svc;
+  svc.messenger.threshold = LogLevel::Off;
+  parallel.initialize(svc);
+  SenseInfo sense;
+  for (int ticks = 1;; ++ticks) {
+    auto o = parallel.tick(sense);
+    if (o.value != Outcome::Return::Running || ticks == 100) {
+      return {o, ticks};
+    }
+  }
+}
+
+void test_parallel_element() {
+  constexpr auto S = Outcome::Return::Success;
+  constexpr auto F = Outcome::Return::Fail;
+  ThreadPool pool(3);
+  Leaf a(1, S, 1.0);
+  Leaf b(3, S, 2.0);
+  Leaf c(2, F, 3.0);
+  ParallelElement::Elements children{std::ref(a), std::ref(b), std::ref(c)};
+
+  ParallelElement all(children, pool);
+  auto [o, ticks] = run(all);
+  check(o.value == F && ticks == 2, "by default the first failure fails the parallel");
+
+  ParallelElement two_of_three(children, pool, 2, 2);
+  std::tie(o, ticks) = run(two_of_three);
+  check(o.value == S && ticks == 3, "the parallel succeeds once two children succeeded");
+
+  ParallelElement three_of_three(children, pool, 3, 3);
+  std::tie(o, ticks) = run(three_of_three);
+  check(o.value == F && ticks == 3, "the parallel fails once it cannot succeed anymore");
+
+  ParallelElement any(children, pool, 1, 3);
+  std::tie(o, ticks) = run(any);
+  check(o.value == S && ticks == 1, "the parallel succeeds with its first success");
+  check(o.actuate.velocity == 1.0, "the command is the first ticked child's");
+
+  ParallelElement::Elements none;
+  ParallelElement empty(none, pool);
+  std::tie(o, ticks) = run(empty);
+  check(o.value == F && ticks == 1, "a parallel without children fails");
+}
+
+} // namespace
+
+int main() {
+  test_overflow();
+  test_nested_overflow();
+  test_parallel_for();
+  test_parallel_element();
+  std::printf("%d checks failed\n", failed);
+  return failed == 0 ? 0 : 1;
+}
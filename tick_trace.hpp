@@ -0,0 +1,312 @@
+#pragma once
+#include "behavior_element.hpp"
+#include "sense_history.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+// Binary tick traces, for reproducing a field failure by replaying the robot's sense through the
+// tree. A trace is a header followed by fixed-width records, appended in the order they happened:
+// the sense of every executor loop, the lifecycle transitions of the elements and the outcome of
+// every tick of the root. The element names are interned, the first record of an element is a
+// TraceKind_NAME record assigning its id.
+
+// The kind of a TraceRecord
+enum TraceKind : uint8_t {
+  TraceKind_NAME = 0,       // element id -> name, the name is in the payload
+  TraceKind_SENSE = 1,      // values: velocity, x; flags: TraceFlag_*
+  TraceKind_OUTCOME = 2,    // values: actuated velocity; flags: Outcome::Return
+  TraceKind_INITIALIZE = 3, // lifecycle transitions, TraceKind_INITIALIZE + LifecycleKind
+  TraceKind_TICK = 4,
+  TraceKind_FINALIZE = 5,   // flags: the Outcome::Return completing the element
+};
+
+// The boolean sense fields of a TraceKind_SENSE record
+enum TraceFlag : uint8_t {
+  TraceFlag_FLINCHING = 1u << 0,
+  TraceFlag_KNEE_JERKING = 1u << 1,
+};
+
+struct TraceRecord {
+  static constexpr std::size_t NAME_LEN = 16;
+
+  int64_t ts;       // ns since the steady clock's epoch, of the sense of the tick
+  uint8_t kind;     // TraceKind
+  uint8_t flags;    // see TraceKind
+  uint16_t element; // id of the element, see TraceKind_NAME
+  uint32_t reserved;
+  union {
+    double values[2];
+    char name[NAME_LEN]; // not terminated when the name fills it
+  };
+};
+static_assert(sizeof(TraceRecord) == 32, "the trace record layout is part of the file format");
+
+struct TraceHeader {
+  static constexpr char MAGIC[8] = {'D', 'F', 'S', 'T', 'R', 'A', 'C', 'E'};
+  static constexpr uint32_t VERSION = 1;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t count; // the records completely written
+  uint64_t reserved;
+};
+static_assert(sizeof(TraceHeader) == 32, "the trace header layout is part of the file format");
+
+namespace trace_detail {
+[[noreturn]] inline void fail(const char *what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+inline int64_t to_ns(std::chrono::steady_clock::time_point ts) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(ts.time_since_epoch()).count();
+}
+} // namespace trace_detail
+
+// Records the tick trace into a memory-mapped file. Appending a record is a copy into the mapping,
+// the kernel writes the pages back in the background; only growing the file, every time the
+// capacity doubles, is a system call on the tick thread. The header's count is updated after every
+// record, a trace cut short by a crash holds every record up to the crash.
+//
+//   TraceWriter trace("mission.trace");
+//   svc.trace.sink = &trace;
+//   svc.lifecycle.subscribe(&trace);
+//   Executor::run(root, schedule, svc);
+//
+// The lifecycle records are stamped with the time of the tick's sense, like the rest of the trace.
+class TraceWriter : public TraceSink, public LifecycleSubscriber {
+public:
+  static constexpr std::size_t MAX_ELEMENTS = 256;
+
+  explicit TraceWriter(const char *path, std::size_t capacity = std::size_t{1} << 16) {
+    m_fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0) {
+      trace_detail::fail("open trace");
+    }
+    map(capacity);
+    std::memcpy(header().magic, TraceHeader::MAGIC, sizeof(TraceHeader::MAGIC));
+    header().version = TraceHeader::VERSION;
+    header().record_size = sizeof(TraceRecord);
+  }
+
+  TraceWriter(const TraceWriter &) = delete;
+  TraceWriter &operator=(const TraceWriter &) = delete;
+
+  // Truncates the file to the records written
+  ~TraceWriter() {
+    ::munmap(m_map, bytes(m_capacity));
+    static_cast<void>(::ftruncate(m_fd, static_cast<off_t>(bytes(m_count))));
+    ::close(m_fd);
+  }
+
+  void sense(const SenseInfo &s) override {
+    m_ts = trace_detail::to_ns(s.ts);
+    auto &r = append(TraceKind_SENSE, 0);
+    r.flags = static_cast<uint8_t>((s.is_flinching ? TraceFlag_FLINCHING : 0) |
+                                   (s.is_knee_jerking ? TraceFlag_KNEE_JERKING : 0));
+    r.values[0] = s.measured_velocity;
+    r.values[1] = s.measured_x;
+  }
+
+  void outcome(const char *source, const Outcome &o) override {
+    auto &r = append(TraceKind_OUTCOME, id(source));
+    r.flags = static_cast<uint8_t>(o.value);
+    r.values[0] = o.actuate.velocity;
+  }
+
+  void on_lifecycle(const LifecycleEvent &event) override {
+    auto kind = static_cast<uint8_t>(TraceKind_INITIALIZE + uint8_t{event.kind});
+    auto &r = append(kind, id(event.name));
+    if (event.kind == LifecycleKind_FINALIZE) {
+      r.flags = static_cast<uint8_t>(event.outcome);
+    }
+  }
+
+  std::size_t size() const { return m_count; }
+
+private:
+  static std::size_t bytes(std::size_t records) {
+    return sizeof(TraceHeader) + records * sizeof(TraceRecord);
+  }
+
+  TraceHeader &header() { return *static_cast<TraceHeader *>(m_map); }
+
+  TraceRecord *records() {
+    return reinterpret_cast<TraceRecord *>(static_cast<char *>(m_map) + sizeof(TraceHeader));
+  }
+
+  void map(std::size_t capacity) {
+    if (::ftruncate(m_fd, static_cast<off_t>(bytes(capacity))) != 0) {
+      trace_detail::fail("grow trace");
+    }
+    void *mem = ::mmap(nullptr, bytes(capacity), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (mem == MAP_FAILED) {
+      trace_detail::fail("map trace");
+    }
+    m_map = mem;
+    m_capacity = capacity;
+  }
+
+  TraceRecord &append(uint8_t kind, uint16_t element) {
+    if (m_count == m_capacity) {
+      ::munmap(m_map, bytes(m_capacity));
+      map(m_capacity * 2);
+    }
+    auto &r = records()[m_count];
+    std::memset(&r, 0, sizeof(r));
+    r.ts = m_ts;
+    r.kind = kind;
+    r.element = element;
+    header().count = ++m_count;
+    return r;
+  }
+
+  // The id of the element's name, recording the name the first time it is seen. Names beyond
+  // MAX_ELEMENTS share the last id.
+  uint16_t id(const char *name) {
+    if (name == nullptr) {
+      name = "";
+    }
+    for (std::size_t i = 0; i < m_names_size; ++i) {
+      if (m_names[i] == name || std::strcmp(m_names[i], name) == 0) {
+        return static_cast<uint16_t>(i);
+      }
+    }
+    if (m_names_size == MAX_ELEMENTS) {
+      return static_cast<uint16_t>(MAX_ELEMENTS - 1);
+    }
+    auto id = static_cast<uint16_t>(m_names_size++);
+    m_names[id] = name;
+    auto &r = append(TraceKind_NAME, id);
+    std::strncpy(r.name, name, TraceRecord::NAME_LEN);
+    return id;
+  }
+
+  int m_fd{-1};
+  void *m_map{nullptr};
+  std::size_t m_capacity{0};
+  std::size_t m_count{0};
+  int64_t m_ts{0};
+  const char *m_names[MAX_ELEMENTS]{};
+  std::size_t m_names_size{0};
+};
+
+// Maps a recorded trace read-only
+class TraceReader {
+public:
+  explicit TraceReader(const char *path) {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+      trace_detail::fail("open trace");
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(TraceHeader)) {
+      ::close(fd);
+      throw std::system_error(std::make_error_code(std::errc::invalid_argument), "trace too short");
+    }
+    m_bytes = static_cast<std::size_t>(st.st_size);
+    void *mem = ::mmap(nullptr, m_bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+      trace_detail::fail("map trace");
+    }
+    m_map = mem;
+
+    auto &h = *static_cast<const TraceHeader *>(m_map);
+    if (std::memcmp(h.magic, TraceHeader::MAGIC, sizeof(TraceHeader::MAGIC)) != 0 ||
+        h.version != TraceHeader::VERSION || h.record_size != sizeof(TraceRecord)) {
+      ::munmap(m_map, m_bytes);
+      throw std::system_error(std::make_error_code(std::errc::invalid_argument), "not a trace");
+    }
+    m_count = std::min<std::size_t>(h.count, (m_bytes - sizeof(TraceHeader)) / sizeof(TraceRecord));
+  }
+
+  TraceReader(const TraceReader &) = delete;
+  TraceReader &operator=(const TraceReader &) = delete;
+
+  ~TraceReader() { ::munmap(m_map, m_bytes); }
+
+  std::size_t size() const { return m_count; }
+  const TraceRecord *begin() const {
+    return reinterpret_cast<const TraceRecord *>(static_cast<const char *>(m_map) +
+                                                 sizeof(TraceHeader));
+  }
+  const TraceRecord *end() const { return begin() + m_count; }
+  const TraceRecord &operator[](std::size_t i) const { return begin()[i]; }
+
+  // The sense sample of a TraceKind_SENSE record
+  static SenseInfo sense(const TraceRecord &r) {
+    SenseInfo s;
+    s.measured_velocity = r.values[0];
+    s.measured_x = r.values[1];
+    s.is_flinching = (r.flags & TraceFlag_FLINCHING) != 0;
+    s.is_knee_jerking = (r.flags & TraceFlag_KNEE_JERKING) != 0;
+    s.ts = std::chrono::steady_clock::time_point{std::chrono::nanoseconds{r.ts}};
+    return s;
+  }
+
+private:
+  void *m_map{nullptr};
+  std::size_t m_bytes{0};
+  std::size_t m_count{0};
+};
+
+// Runs a tree on a recorded trace instead of a robot, as fast as possible. The recorded sense
+// samples are fed to the tree's history and the tree is ticked exactly where the recording ticked
+// its root, reactive skips included, so a deterministic tree reproduces the recorded run. Every
+// outcome is compared to the recorded one.
+struct ReplayExecutor {
+  struct Result {
+    Outcome out;
+    uint64_t ticks{0};
+    uint64_t mismatches{0}; // ticks whose outcome differs from the recorded outcome
+    std::size_t first_mismatch{SIZE_MAX}; // the index of the first differing outcome record
+  };
+
+  static Result run(BehaviorElement &element, const TraceReader &trace, Services svc = {}) {
+    Result result;
+    SenseHistory history;
+    svc.history = &history;
+    SenseInfo sense;
+
+    auto meta = element.initialize(svc);
+    svc.lifecycle.emit(LifecycleKind_INITIALIZE, &element, meta.name);
+
+    for (std::size_t i = 0; i < trace.size(); ++i) {
+      const auto &r = trace[i];
+      if (r.kind == TraceKind_SENSE) {
+        sense = TraceReader::sense(r);
+        history.push(sense);
+        svc.trace.sense(sense);
+        svc.lifecycle.now = sense.ts;
+      } else if (r.kind == TraceKind_OUTCOME) {
+        svc.lifecycle.emit(LifecycleKind_TICK, &element, meta.name);
+        result.out = element.tick(sense);
+        svc.trace.outcome(meta.name, result.out);
+        ++result.ticks;
+        if (static_cast<uint8_t>(result.out.value) != r.flags ||
+            result.out.actuate.velocity != r.values[0]) {
+          if (result.mismatches++ == 0) {
+            result.first_mismatch = i;
+          }
+        }
+        if (result.out.value != Outcome::Return::Running) {
+          break;
+        }
+      }
+    }
+
+    element.finalize();
+    svc.lifecycle.emit(LifecycleKind_FINALIZE, &element, meta.name, result.out.value);
+    return result;
+  }
+};
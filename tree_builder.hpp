@@ -0,0 +1,89 @@
+#pragma once
+#include "element.hpp"
+#include <cstddef>
+#include <initializer_list>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Builds a behavior tree whose elements and child lists are all allocated from one monotonic arena.
+// Allocating is a pointer bump, and tearing the tree down destroys the elements and releases the
+// arena in bulk, so assembling and discarding trees at mission start does not go through the
+// general purpose allocator element by element.
+//
+//   TreeBuilder tree;
+//   auto &walk = tree.make<WalkToPosition>(4);
+//   auto &stop = tree.make<Stop>();
+//   auto &root = tree.sequence({walk, stop});
+//   Executor::run(root);
+//
+// The arena's blocks come from an upstream resource. For a fixed RAM budget hand the builder a
+// buffer, exhausting it then throws std::bad_alloc instead of touching the heap. To recycle the
+// blocks of trees built and torn down repeatedly, share a std::pmr::unsynchronized_pool_resource
+// between builders as the upstream.
+class TreeBuilder {
+public:
+  explicit TreeBuilder(std::pmr::memory_resource *upstream = std::pmr::get_default_resource())
+      : m_arena(upstream) {}
+  TreeBuilder(void *buffer, std::size_t size,
+              std::pmr::memory_resource *upstream = std::pmr::null_memory_resource())
+      : m_arena(buffer, size, upstream) {}
+
+  TreeBuilder(const TreeBuilder &) = delete;
+  TreeBuilder &operator=(const TreeBuilder &) = delete;
+
+  ~TreeBuilder() { release(); }
+
+  // Constructs an element in the arena. The element lives until release().
+  template <class T, class... Args> T &make(Args &&...args) {
+    void *mem = m_arena.allocate(sizeof(T), alignof(T));
+    T *obj = new (mem) T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible<T>::value) {
+      void *node = m_arena.allocate(sizeof(Destructor), alignof(Destructor));
+      m_destructors = new (node) Destructor{&destroy<T>, obj, m_destructors};
+    }
+    return *obj;
+  }
+
+  // Constructs a SequenceElement in the arena with its child list allocated from the arena as well
+  SequenceElement &sequence(std::initializer_list<std::reference_wrapper<BehaviorElement>> children) {
+    return make<SequenceElement>(children, resource());
+  }
+
+  // Constructs a FallbackElement in the arena with its child list allocated from the arena as well
+  FallbackElement &fallback(std::initializer_list<std::reference_wrapper<BehaviorElement>> children) {
+    return make<FallbackElement>(children, resource());
+  }
+
+  // The arena, for composites taking a memory resource for their child lists
+  std::pmr::memory_resource *resource() { return &m_arena; }
+
+  // A pool on top of the arena for the coroutine frames of CoroutineElements. Frames freed when an
+  // element is finalized are reused by the next initialize instead of growing the arena.
+  std::pmr::memory_resource *frames() { return &m_frames; }
+
+  // Destroys every element in reverse order of construction and releases the arena in one step. The
+  // builder can then be reused for the next tree.
+  void release() {
+    for (auto *d = m_destructors; d != nullptr; d = d->next) {
+      d->fn(d->obj);
+    }
+    m_destructors = nullptr;
+    m_frames.release();
+    m_arena.release();
+  }
+
+private:
+  struct Destructor {
+    void (*fn)(void *);
+    void *obj;
+    Destructor *next;
+  };
+
+  template <class T> static void destroy(void *obj) { static_cast<T *>(obj)->~T(); }
+
+  std::pmr::monotonic_buffer_resource m_arena;
+  std::pmr::unsynchronized_pool_resource m_frames{&m_arena};
+  Destructor *m_destructors{nullptr};
+};
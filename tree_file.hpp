@@ -0,0 +1,288 @@
+#pragma once
+#include "cancellation.hpp"
+#include "element_registry.hpp"
+#include "tree_builder.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+// Tree files, behavior trees described in a compact binary format and built at startup instead of
+// in code. A tree file is a header followed by one fixed-width record per element, in preorder
+// like the nodes of a FlatTree: a node's children follow it, each child's subtree ends where the
+// next sibling starts. A record names the element's type, resolved through an ElementRegistry, and
+// holds the element's numeric parameters, e.g. the goal of a WalkToPosition.
+//
+// Loading a file is a single read-only mapping and one pass over its records, building the elements
+// into a TreeBuilder arena from the last record to the first, so every composite finds its
+// children built. There is nothing to parse: the children are found by their indices.
+
+struct TreeNodeRecord {
+  static constexpr std::size_t TYPE_LEN = 24;
+
+  char type[TYPE_LEN]; // the element type's name, not terminated when the name fills it
+  uint32_t end;        // one past the last node of the subtree, the next sibling
+  uint32_t reserved;
+  double params[ElementArgs::MAX_PARAMS];
+};
+static_assert(sizeof(TreeNodeRecord) == 64, "the node record layout is part of the file format");
+
+struct TreeFileHeader {
+  static constexpr char MAGIC[8] = {'D', 'F', 'S', 'T', 'R', 'E', 'E', 'S'};
+  static constexpr uint32_t VERSION = 1;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t count; // the node records, the root is the first
+  uint64_t reserved;
+};
+static_assert(sizeof(TreeFileHeader) == 32, "the tree header layout is part of the file format");
+
+namespace tree_file_detail {
+[[noreturn]] inline void fail(const char *what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+[[noreturn]] inline void invalid(const std::string &what) {
+  throw std::system_error(std::make_error_code(std::errc::invalid_argument), what);
+}
+} // namespace tree_file_detail
+
+// A tree description written in code, for authoring tree files
+//
+//   TreeSpec mission{"Sequence", {}, {{"WalkToPosition", {4}}, {"Stop"}}};
+//   write_tree_file("mission.tree", mission);
+struct TreeSpec {
+  const char *type;
+  std::vector<double> params;
+  std::vector<TreeSpec> children;
+};
+
+// The records of the description, in preorder
+inline std::vector<TreeNodeRecord> tree_records(const TreeSpec &root) {
+  std::vector<TreeNodeRecord> records;
+  auto append = [&records](const TreeSpec &spec, auto &self) -> void {
+    if (std::strlen(spec.type) > TreeNodeRecord::TYPE_LEN) {
+      tree_file_detail::invalid(std::string("element type name too long: ") + spec.type);
+    }
+    if (spec.params.size() > ElementArgs::MAX_PARAMS) {
+      tree_file_detail::invalid(std::string("too many parameters: ") + spec.type);
+    }
+    auto index = records.size();
+    TreeNodeRecord r{};
+    std::strncpy(r.type, spec.type, TreeNodeRecord::TYPE_LEN);
+    std::copy(spec.params.begin(), spec.params.end(), r.params);
+    records.push_back(r);
+    for (const auto &child : spec.children) {
+      self(child, self);
+    }
+    records[index].end = static_cast<uint32_t>(records.size());
+  };
+  append(root, append);
+  return records;
+}
+
+inline void write_tree_file(const char *path, const TreeSpec &root) {
+  auto records = tree_records(root);
+  TreeFileHeader header{};
+  std::memcpy(header.magic, TreeFileHeader::MAGIC, sizeof(TreeFileHeader::MAGIC));
+  header.version = TreeFileHeader::VERSION;
+  header.record_size = sizeof(TreeNodeRecord);
+  header.count = records.size();
+
+  int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    tree_file_detail::fail("open tree file");
+  }
+  auto write_all = [fd](const void *data, std::size_t size) {
+    auto *p = static_cast<const char *>(data);
+    while (size > 0) {
+      auto n = ::write(fd, p, size);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        ::close(fd);
+        tree_file_detail::fail("write tree file");
+      }
+      p += n;
+      size -= static_cast<std::size_t>(n);
+    }
+  };
+  write_all(&header, sizeof(header));
+  write_all(records.data(), records.size() * sizeof(TreeNodeRecord));
+  ::close(fd);
+}
+
+// Maps a tree file read-only. The records are checked when the tree is loaded, see load_tree().
+class TreeFile {
+public:
+  explicit TreeFile(const char *path) {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+      tree_file_detail::fail("open tree file");
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(TreeFileHeader)) {
+      ::close(fd);
+      tree_file_detail::invalid("tree file too short");
+    }
+    m_bytes = static_cast<std::size_t>(st.st_size);
+    void *mem = ::mmap(nullptr, m_bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+      tree_file_detail::fail("map tree file");
+    }
+    m_map = mem;
+
+    auto &h = *static_cast<const TreeFileHeader *>(m_map);
+    if (std::memcmp(h.magic, TreeFileHeader::MAGIC, sizeof(TreeFileHeader::MAGIC)) != 0 ||
+        h.version != TreeFileHeader::VERSION || h.record_size != sizeof(TreeNodeRecord) ||
+        h.count == 0 || h.count > (m_bytes - sizeof(TreeFileHeader)) / sizeof(TreeNodeRecord)) {
+      ::munmap(m_map, m_bytes);
+      tree_file_detail::invalid("not a tree file");
+    }
+    m_count = static_cast<std::size_t>(h.count);
+  }
+
+  TreeFile(const TreeFile &) = delete;
+  TreeFile &operator=(const TreeFile &) = delete;
+
+  ~TreeFile() { ::munmap(m_map, m_bytes); }
+
+  std::size_t size() const { return m_count; }
+  const TreeNodeRecord *begin() const {
+    return reinterpret_cast<const TreeNodeRecord *>(static_cast<const char *>(m_map) +
+                                                    sizeof(TreeFileHeader));
+  }
+  const TreeNodeRecord *end() const { return begin() + m_count; }
+  const TreeNodeRecord &operator[](std::size_t i) const { return begin()[i]; }
+
+private:
+  void *m_map{nullptr};
+  std::size_t m_bytes{0};
+  std::size_t m_count{0};
+};
+
+// Builds the tree of the records into the arena and returns its root. The records come from a
+// TreeFile or tree_records(). Throws std::system_error for types the registry does not know, a
+// wrong number of children, parameters the factory rejects or records not nesting; the elements
+// built so far stay in the arena until it is released.
+inline BehaviorElement &load_tree(const TreeNodeRecord *records, std::size_t count,
+                                  const ElementRegistry &registry, TreeBuilder &tree) {
+  if (count == 0 || records[0].end != count) {
+    tree_file_detail::invalid("malformed tree file");
+  }
+  std::vector<BehaviorElement *> built(count);
+  SequenceElement::Elements children;
+  for (std::size_t i = count; i-- > 0;) {
+    const auto &node = records[i];
+    if (node.end <= i || node.end > count) {
+      tree_file_detail::invalid("malformed tree file");
+    }
+    auto len = strnlen(node.type, TreeNodeRecord::TYPE_LEN);
+    const auto *type = registry.find(node.type, len);
+    if (type == nullptr) {
+      tree_file_detail::invalid("unknown element type " + std::string(node.type, len));
+    }
+
+    children.clear();
+    for (std::size_t j = i + 1; j < node.end; j = records[j].end) {
+      if (records[j].end <= j || records[j].end > node.end) {
+        tree_file_detail::invalid("malformed tree file");
+      }
+      children.push_back(*built[j]);
+    }
+    if (children.size() < type->min_children || children.size() > type->max_children) {
+      tree_file_detail::invalid("wrong number of children for " + std::string(type->name));
+    }
+    built[i] = &type->factory(tree, ElementArgs{node.params, children});
+  }
+  return *built[0];
+}
+
+inline BehaviorElement &load_tree(const TreeFile &file, const ElementRegistry &registry,
+                                  TreeBuilder &tree) {
+  return load_tree(file.begin(), file.size(), registry, tree);
+}
+
+// Replaces the tree of a running executor with a tree loaded from a file, at a tick boundary, so a
+// mission change does not restart the process. The trees live in two alternating arenas, the
+// running tree's and the next.
+//
+//   TreeSwap missions(registry, token);
+//   auto &root = missions.load("mission.tree");
+//   auto result = std::async(std::launch::async,
+//                            [&] { return Executor::run(root, schedule, svc, token); });
+//   ...
+//   missions.swap("mission.tree"); // e.g. after the file changed
+//
+// swap() builds the next tree on the calling thread while the running tree keeps ticking, then
+// preempts the run through the CancelToken: the executor finalizes the running chain at the start
+// of its next tick and ticks the new tree in the same tick. The replaced tree is destroyed by the
+// swap after, once the executor reported its preemption complete; until then a swap is refused. A
+// file failing to load throws and leaves the running tree in place.
+class TreeSwap {
+public:
+  TreeSwap(const ElementRegistry &registry, CancelToken &token,
+           std::pmr::memory_resource *upstream = std::pmr::get_default_resource())
+      : m_registry(registry), m_token(token), m_trees{TreeBuilder(upstream), TreeBuilder(upstream)},
+        m_preemptions(token.preemptions()) {}
+
+  TreeSwap(const TreeSwap &) = delete;
+  TreeSwap &operator=(const TreeSwap &) = delete;
+
+  // Loads the first tree, before the run starts, replacing the tree loaded before
+  BehaviorElement &load(const char *path) {
+    auto &root = build(m_current, path);
+    m_roots[m_current] = &root;
+    return root;
+  }
+
+  // Loads the next tree and hands it to the run. False, without loading, while the executor did not
+  // take the previous swap yet.
+  bool swap(const char *path) {
+    if (m_token.preemptions() != m_preemptions) {
+      return false;
+    }
+    auto next = 1 - m_current;
+    m_roots[next] = &build(next, path);
+    m_current = next;
+    ++m_preemptions;
+    m_token.preempt(*m_roots[next]);
+    return true;
+  }
+
+  // The root of the tree loaded last, null before the first load
+  BehaviorElement *root() const { return m_roots[m_current]; }
+
+private:
+  BehaviorElement &build(std::size_t slot, const char *path) {
+    auto &tree = m_trees[slot];
+    tree.release();
+    m_roots[slot] = nullptr;
+    try {
+      TreeFile file(path);
+      return load_tree(file, m_registry, tree);
+    } catch (...) {
+      tree.release();
+      throw;
+    }
+  }
+
+  const ElementRegistry &m_registry;
+  CancelToken &m_token;
+  TreeBuilder m_trees[2];
+  BehaviorElement *m_roots[2]{};
+  std::size_t m_current{0};
+  uint64_t m_preemptions; // the preemptions requested, complete once the token counted them
+};
@@ -0,0 +1,207 @@
+#include "cancellation.hpp"
+#include "motion_elements.hpp"
+#include "tree_file.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <initializer_list>
+#include <limits>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+// Checks that tree files are rejected unless every record is valid: the file's header, the nesting
+// of the records, the element types and their number of children, and every parameter, since the
+// files are not trusted. A rejected file throws std::system_error without building a tree, and a
+// rejected swap leaves the running tree in place.
+
+namespace {
+
+const char *const PATH = "tree_file_test.tree";
+constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+constexpr double INF = std::numeric_limits<double>::infinity();
+
+int failed = 0;
+
+void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::printf("FAILED: %s\n", what.c_str());
+    ++failed;
+  }
+}
+
+ElementRegistry registry() {
+  auto r = ElementRegistry::with_composites();
+  r.add<WalkToPosition>();
+  r.add<Stop>();
+  return r;
+}
+
+// True when the records load, false when they are rejected as invalid
+bool loads(const std::vector<TreeNodeRecord> &records) {
+  auto r = registry();
+  TreeBuilder tree;
+  try {
+    load_tree(records.data(), records.size(), r, tree);
+    return true;
+  } catch (const std::system_error &e) {
+    check(e.code() == std::errc::invalid_argument, std::string("invalid argument: ") + e.what());
+    return false;
+  }
+}
+
+bool loads(const TreeSpec &spec) { return loads(tree_records(spec)); }
+
+void test_valid() {
+  check(loads(TreeSpec{"Stop", {}, {}}), "a single leaf loads");
+  check(loads(TreeSpec{"Sequence",
+                       {},
+                       {{"WalkToPosition", {4}, {}},
+                        {"Retry", {3}, {{"Stop", {}, {}}}},
+                        {"Timeout", {0.5}, {{"RateLimit", {0.1}, {{"Stop", {}, {}}}}}},
+                        {"Fallback", {}, {{"Inverter", {}, {{"Stop", {}, {}}}}}},
+                        {"Sequence", {}, {}}}}),
+        "a tree of every registered type loads");
+}
+
+void test_structure() {
+  check(!loads(TreeSpec{"Jump", {}, {}}), "an unknown type is rejected");
+  check(!loads(TreeSpec{"Inverter", {}, {}}), "a decorator without a child is rejected");
+  check(!loads(TreeSpec{"Inverter", {}, {{"Stop", {}, {}}, {"Stop", {}, {}}}}),
+        "a decorator with two children is rejected");
+  check(!loads(TreeSpec{"Stop", {}, {{"Stop", {}, {}}}}), "a leaf with a child is rejected");
+
+  auto nested = tree_records(TreeSpec{
+      "Sequence", {}, {{"Inverter", {}, {{"Stop", {}, {}}}}, {"Stop", {}, {}}}});
+  check(loads(nested), "the nested records load");
+  auto records = nested;
+  records[0].end = 3;
+  check(!loads(records), "a root not spanning every record is rejected");
+  records = nested;
+  records[1].end = 1;
+  check(!loads(records), "a subtree ending at its own node is rejected");
+  records = nested;
+  records[1].end = 5;
+  check(!loads(records), "a subtree ending after the tree is rejected");
+  records = nested;
+  records[2].end = 4;
+  check(!loads(records), "a subtree ending after its parent is rejected");
+  check(!loads(std::vector<TreeNodeRecord>{}), "no records are rejected");
+}
+
+void test_params() {
+  for (double attempts : {NaN, INF, -1.0, 0.0, 2.5, 1e20}) {
+    check(!loads(TreeSpec{"Retry", {attempts}, {{"Stop", {}, {}}}}),
+          "Retry attempts " + std::to_string(attempts) + " are rejected");
+  }
+  for (const char *type : {"Timeout", "RateLimit"}) {
+    for (double seconds : {NaN, INF, -1.0, 0.0, 1e12}) {
+      check(!loads(TreeSpec{type, {seconds}, {{"Stop", {}, {}}}}),
+            std::string(type) + " seconds " + std::to_string(seconds) + " are rejected");
+    }
+  }
+  for (double goal : {NaN, INF, -INF}) {
+    check(!loads(TreeSpec{"WalkToPosition", {goal}, {}}),
+          "WalkToPosition goal " + std::to_string(goal) + " is rejected");
+  }
+
+  // parameters the element does not take
+  check(!loads(TreeSpec{"Stop", {3}, {}}), "a parameter of Stop is rejected");
+  check(!loads(TreeSpec{"Stop", {0, 0, 0, NaN}, {}}), "a NaN unused parameter is rejected");
+  check(!loads(TreeSpec{"WalkToPosition", {4, 1}, {}}), "a second goal is rejected");
+  check(!loads(TreeSpec{"Sequence", {1}, {}}), "a parameter of Sequence is rejected");
+  check(!loads(TreeSpec{"Fallback", {0, 2}, {}}), "a parameter of Fallback is rejected");
+  check(!loads(TreeSpec{"Inverter", {1}, {{"Stop", {}, {}}}}),
+        "a parameter of Inverter is rejected");
+  check(!loads(TreeSpec{"Retry", {2, 1}, {{"Stop", {}, {}}}}),
+        "a second parameter of Retry is rejected");
+  check(!loads(TreeSpec{"Timeout", {1, 0, 0, 5}, {{"Stop", {}, {}}}}),
+        "a last parameter of Timeout is rejected");
+}
+
+void write_file(const void *data, std::size_t size) {
+  int fd = ::open(PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  check(fd >= 0 && ::write(fd, data, size) == static_cast<ssize_t>(size), "write the test file");
+  ::close(fd);
+}
+
+bool maps() {
+  try {
+    TreeFile file(PATH);
+    return true;
+  } catch (const std::system_error &e) {
+    check(e.code() == std::errc::invalid_argument, std::string("invalid argument: ") + e.what());
+    return false;
+  }
+}
+
+void test_file() {
+  write_tree_file(PATH, TreeSpec{"Sequence", {}, {{"WalkToPosition", {4}, {}}, {"Stop", {}, {}}}});
+  check(maps(), "a written file maps");
+  {
+    TreeFile file(PATH);
+    auto r = registry();
+    TreeBuilder tree;
+    check(file.size() == 3 && load_tree(file, r, tree).footprint().elements == 3,
+          "a written file loads its tree");
+  }
+
+  TreeFileHeader header{};
+  write_file(&header, sizeof(header) - 1);
+  check(!maps(), "a file shorter than the header is rejected");
+
+  std::memcpy(header.magic, TreeFileHeader::MAGIC, sizeof(header.magic));
+  header.version = TreeFileHeader::VERSION;
+  header.record_size = sizeof(TreeNodeRecord);
+  header.count = 1;
+  write_file(&header, sizeof(header));
+  check(!maps(), "a header counting more records than the file holds is rejected");
+
+  header.count = 0;
+  write_file(&header, sizeof(header));
+  check(!maps(), "a file without records is rejected");
+
+  header.count = 1;
+  header.version = TreeFileHeader::VERSION + 1;
+  write_file(&header, sizeof(header));
+  check(!maps(), "another version is rejected");
+
+  header.version = TreeFileHeader::VERSION;
+  header.magic[0] = 'X';
+  write_file(&header, sizeof(header));
+  check(!maps(), "another magic is rejected");
+}
+
+void test_swap() {
+  auto r = registry();
+  CancelToken token;
+  TreeSwap missions(r, token);
+  write_tree_file(PATH, TreeSpec{"Stop", {}, {}});
+  auto *running = &missions.load(PATH);
+
+  write_tree_file(PATH, TreeSpec{"Retry", {NaN}, {{"Stop", {}, {}}}});
+  bool thrown = false;
+  try {
+    missions.swap(PATH);
+  } catch (const std::system_error &) {
+    thrown = true;
+  }
+  check(thrown, "a swap to an invalid file throws");
+  check(missions.root() == running, "a rejected swap keeps the running tree");
+  check(token.take_preemption() == nullptr, "a rejected swap does not preempt the run");
+}
+
+} // namespace
+
+int main() {
+  test_valid();
+  test_structure();
+  test_params();
+  test_file();
+  test_swap();
+  ::unlink(PATH);
+  std::printf("%d checks failed\n", failed);
+  return failed == 0 ? 0 : 1;
+}
@@ -1,7 +1,10 @@
 #pragma once
+#include "log.hpp"
+#include "reaction_state.hpp"
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
-#include <iostream>
+#include <cstring>
 #include <string>
 
 // Sensor information describing the state of the robot.
@@ -13,6 +16,38 @@ struct SenseInfo {
   std::chrono::steady_clock::time_point ts;
 };
 
+// The fields of the SenseInfo an element's tick can depend on
+enum SenseField : uint32_t {
+  SenseField_VELOCITY = 1u << 0,
+  SenseField_X = 1u << 1,
+  SenseField_FLINCHING = 1u << 2,
+  SenseField_KNEE_JERKING = 1u << 3,
+  SenseField_TIME = 1u << 4, // the timestamp, changes on every sample
+  SenseField_ALL = (1u << 5) - 1,
+};
+
+// True when any of the fields in the mask differ between the samples
+inline bool sense_changed(uint32_t mask, const SenseInfo &a, const SenseInfo &b) {
+  return ((mask & SenseField_VELOCITY) && a.measured_velocity != b.measured_velocity) ||
+         ((mask & SenseField_X) && a.measured_x != b.measured_x) ||
+         ((mask & SenseField_FLINCHING) && a.is_flinching != b.is_flinching) ||
+         ((mask & SenseField_KNEE_JERKING) && a.is_knee_jerking != b.is_knee_jerking) ||
+         ((mask & SenseField_TIME) && a.ts != b.ts);
+}
+
+// Describes when a running element needs to be ticked next: once one of the sense fields in the
+// mask changed, or once the deadline passed. Until then the element's outcome would not change and a
+// reactive executor may skip its ticks. The default wakes on every sample.
+struct WakeCondition {
+  uint32_t sense_mask{SenseField_ALL};
+  std::chrono::steady_clock::time_point deadline{std::chrono::steady_clock::time_point::max()};
+
+  // The condition waking when either of the conditions would, for composites
+  WakeCondition operator|(const WakeCondition &o) const {
+    return WakeCondition{sense_mask | o.sense_mask, std::min(deadline, o.deadline)};
+  }
+};
+
 // Actuation command for the robot
 struct ActuateCmd {
   double velocity;
@@ -34,21 +69,225 @@ struct ElementMeta {
   const char *name{nullptr};
 };
 
+// Destination for the messages sent through the MessengerSvc. A backend allows the messages to be
+// taken off of the tick thread, e.g. the AsyncMessenger. The source is expected to be a string with
+// static storage duration, such as an element's NAME trait, the message is only valid for the call.
+class MessengerBackend {
+public:
+  virtual ~MessengerBackend() = default;
+  virtual void post(const char *source, const char *msg, std::size_t len) = 0;
+  virtual void post(const char *source, const LogRecord &record) = 0;
+};
+
+// The reactions of the robot, the bit positions in a ReactionSet. Up to 64 reactions are supported.
+enum ReactionId : unsigned {
+  ReactionId_KNEE_JERK = 0,
+  ReactionId_FLINCH = 1,
+};
+
+constexpr ReactionSet reaction_bit(ReactionId id) { return ReactionSet{1} << id; }
+
+// The lifecycle transitions of an element, announced through the Services' LifecycleSvc
+enum LifecycleKind : uint8_t {
+  LifecycleKind_INITIALIZE = 0,
+  LifecycleKind_TICK = 1,
+  LifecycleKind_FINALIZE = 2,
+};
+
+// One lifecycle transition. The tick of an element is announced before the element ticks; its
+// finalize carries the outcome it completed with, Running when it was finalized while running.
+struct LifecycleEvent {
+  std::chrono::steady_clock::time_point ts; // the sense timestamp of the tick at the transition
+  const void *element;                      // the element's address, identifies it while it exists
+  const char *name;                         // the element's name with static storage duration
+  LifecycleKind kind;
+  Outcome::Return outcome;
+};
+
+// Receives the lifecycle transitions, e.g. telemetry, a UI or the TraceWriter. Called on the tick
+// thread, a subscriber doing more than a copy should hand the event to its own thread.
+class LifecycleSubscriber {
+public:
+  virtual ~LifecycleSubscriber() = default;
+  virtual void on_lifecycle(const LifecycleEvent &event) = 0;
+};
+
+// Destination of the tick trace sent through the TraceSvc: the sense of every tick and the outcome
+// of the executor's root, e.g. the TraceWriter recording them to a file. The source is an element's
+// name with static storage duration.
+class TraceSink {
+public:
+  virtual ~TraceSink() = default;
+  virtual void sense(const SenseInfo &s) = 0;
+  virtual void outcome(const char *source, const Outcome &o) = 0;
+};
+
+class SenseHistory;
+
 // Common services for all elements. The Services are passed to the element during its initialization.
+// They are shared by reference rather than copied into every element: an element keeps a pointer to
+// the services it was initialized with, which have to outlive the element's run until finalize().
+// The executor's services live in the executor, a composite passes its own services on.
 class Services {
 public:
   struct MessengerSvc {
-    void notify(const char *source, const std::string &msg) {
-      std::cout << "[" << source << "] " << msg << std::endl;
+    void notify(const char *source, const char *msg) const {
+      if (enabled(LogLevel::Info)) {
+        notify(source, msg, std::strlen(msg));
+      }
     }
+    void notify(const char *source, const std::string &msg) const {
+      notify(source, msg.data(), msg.size());
+    }
+    void notify(const char *source, const char *msg, std::size_t len) const {
+      if (!enabled(LogLevel::Info)) {
+        return;
+      }
+      if (backend) {
+        backend->post(source, msg, len);
+      } else {
+        console_write(source, msg, len);
+      }
+    }
+
+    // Structured, allocation free logging. Only the format and the raw argument values are
+    // captured; the text is formatted by the sink. Statements below COMPILED_LOG_LEVEL compile to
+    // nothing, statements below the runtime threshold return before capturing the arguments.
+    //
+    //   static constexpr LogFormat POS_FMT{LogLevel::Debug, "pos={} goal={}"};
+    //   messenger.log<POS_FMT>(NAME, s.measured_x, goal_x);
+    template <const LogFormat &Fmt, class... Args>
+    void log(const char *source, Args... args) const {
+      if constexpr (Fmt.level >= COMPILED_LOG_LEVEL && Fmt.level != LogLevel::Off) {
+        if (!enabled(Fmt.level)) {
+          return;
+        }
+        auto record = make_log_record(Fmt, args...);
+        if (backend) {
+          backend->post(source, record);
+        } else {
+          console_write(source, record);
+        }
+      }
+    }
+
+    bool enabled(LogLevel level) const { return level >= threshold; }
+
+    // when unset the messages are written directly to the console
+    MessengerBackend *backend{nullptr};
+    // messages below the threshold are discarded, LogLevel::Off silences the messenger
+    LogLevel threshold{LogLevel::Debug};
   };
   struct ReactionSvc {
-    void activate(uint32_t bitmap_flag) {}
-    void release(uint32_t bitmap_flag) {}
+    void activate(ReactionSet reactions) const { transition(0, reactions); }
+    void release(ReactionSet reactions) const { transition(reactions, 0); }
+    // Releases and activates reactions in a single update, e.g. when one element hands over to the
+    // next. Has no effect when no reaction layer is connected.
+    void transition(ReactionSet released, ReactionSet activated) const {
+      if (state == nullptr) {
+        return;
+      }
+      state->apply(released, activated);
+    }
+
+    // the reference counted reactions shared with the reflex layer, null when not connected
+    ReactionState *state{nullptr};
+  };
+
+  struct TraceSvc {
+    void sense(const SenseInfo &s) const {
+      if (sink) {
+        sink->sense(s);
+      }
+    }
+    void outcome(const char *source, const Outcome &o) const {
+      if (sink) {
+        sink->outcome(source, o);
+      }
+    }
+    // the recorder of the tick trace, null when not recording
+    TraceSink *sink{nullptr};
+  };
+
+  // The subscribers of the lifecycle transitions, a fixed list set up before the tree starts.
+  // Announcing a transition nobody subscribed to is a load and a branch. A transition is stamped
+  // with the sense timestamp of its tick, like the records of the TraceWriter, so the events are
+  // on the executor's clock, e.g. in simulated time, and cost no clock read.
+  //
+  //   LifecycleLog log(svc.messenger);
+  //   svc.lifecycle.subscribe(&log);
+  struct LifecycleSvc {
+    static constexpr std::size_t MAX_SUBSCRIBERS = 4;
+
+    void emit(LifecycleKind kind, const void *element, const char *name,
+              Outcome::Return outcome = Outcome::Return::Running) const {
+      if (count == 0) {
+        return;
+      }
+      LifecycleEvent event{now, element, name, kind, outcome};
+      for (std::size_t i = 0; i < count; ++i) {
+        subscribers[i]->on_lifecycle(event);
+      }
+    }
+
+    bool active() const { return count != 0; }
+
+    // False when the list is full
+    bool subscribe(LifecycleSubscriber *subscriber) {
+      if (count == MAX_SUBSCRIBERS) {
+        return false;
+      }
+      subscribers[count++] = subscriber;
+      return true;
+    }
+
+    LifecycleSubscriber *subscribers[MAX_SUBSCRIBERS]{};
+    uint8_t count{0};
+    // the sense timestamp of the current tick, set by the executor before it ticks the tree. The
+    // transitions before the first tick carry the clock's epoch.
+    std::chrono::steady_clock::time_point now{};
   };
 
   MessengerSvc messenger;
   ReactionSvc reaction_svc;
+  TraceSvc trace;
+  LifecycleSvc lifecycle;
+  // the history of the executor's sense samples, null when the executor does not keep one
+  const SenseHistory *history{nullptr};
+
+  // The services of an element that was not initialized yet: the console messenger, no reaction
+  // layer, nothing recording or subscribed
+  static const Services &none() {
+    static const Services svc;
+    return svc;
+  }
+};
+
+// Writes the lifecycle transitions to a messenger, e.g. "[Walk] tick", at the Info level
+class LifecycleLog : public LifecycleSubscriber {
+public:
+  static constexpr LogFormat INITIALIZE_FMT{LogLevel::Info, "initialize"};
+  static constexpr LogFormat TICK_FMT{LogLevel::Info, "tick"};
+  static constexpr LogFormat FINALIZE_FMT{LogLevel::Info, "finalize"};
+
+  explicit LifecycleLog(Services::MessengerSvc messenger) : m_messenger(messenger) {}
+
+  void on_lifecycle(const LifecycleEvent &event) override {
+    switch (event.kind) {
+    case LifecycleKind_INITIALIZE:
+      m_messenger.log<INITIALIZE_FMT>(event.name);
+      break;
+    case LifecycleKind_TICK:
+      m_messenger.log<TICK_FMT>(event.name);
+      break;
+    case LifecycleKind_FINALIZE:
+      m_messenger.log<FINALIZE_FMT>(event.name);
+      break;
+    }
+  }
+
+private:
+  Services::MessengerSvc m_messenger;
 };
 
 // Compile Time Reaction Definition Values